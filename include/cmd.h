@@ -5,17 +5,23 @@
 
 #include "drive_mechanics.h"
 #include "pseudo_atomics.h"
+#include "spsc_queue.h"
 
 namespace picostation {
 
+// SENS level of each address, $0X in bit 31 so the mechacon state machine can shift the selected one out
+constexpr uint32_t sensBit(const size_t what) { return 1u << (31 - what); }
+
 class MechCommand {
   public:
     bool getSens(const size_t what) const;
     void setSens(const size_t what, const bool new_value);
-    void setcoutsens() { m_currentSens = 12;}
+    const volatile uint32_t *getSensMask() const { return &m_sensMask; }  // fed to the mechacon PIO by DMA
+    void refreshSens();  // after the mechacon state machine restarts
     bool getSoct();
     void setSoct(const bool new_value);
-    void processLatchedCommand();
+    void processLatchedCommand();    // XLAT IRQ
+    void processDeferredCommands();  // core0 loop
     void updateMech();
     void resetXBUSY();
 	void setBootSectorPattern(const uint8_t value);
@@ -94,7 +100,8 @@ class MechCommand {
 	{
 		EXTENDED_SKIP_BOOTSECTOR = 1,
 		EXTENDED_SKIP_EDC = 2,
-		EXTENDED_GET_CFG = 3
+		EXTENDED_GET_CFG = 3,
+		EXTENDED_GET_STATS = 4
 	};
 
 	typedef union mech_cmd_t
@@ -178,26 +185,28 @@ class MechCommand {
     uint32_t m_latched = 0;  // Command latch
 	uint8_t m_bootSectorPattern = 0;
 
-    size_t m_currentSens = 0;
-    bool m_sensData[16] =
-    {
-        1,  // $0X - FZC
-        1,  // $1X - AS
-        1,  // $2X - TZC
-        1,  // $3X - Misc.
-        1,  // $4X - XBUSY
-        0,  // $5X - FOK
-        1,  // $6X - 0
-        1,  // $7X - 0
-        1,  // $8X - 0
-        1,  // $9X - 0
-        0,  // $AX - GFS
-        0,  // $BX - COMP
-        0,  // $CX - COUT
-        1,  // $DX - 0
-        0,  // $EX - OV64
-        1   // $FX - 0
-    };
+    void deferCommand(const mech_cmd &command);
+
+    SpscQueue<uint32_t, 16> m_deferred;  // XLAT IRQ to the core0 loop
+    uint32_t m_bytesSeen = 0;            // mechacon ring count updateMech last got to
+    size_t m_currentSens = 0;  // address of the last byte received
+    volatile uint32_t m_sensMask =
+        sensBit(0x0) |  // $0X - FZC
+        sensBit(0x1) |  // $1X - AS
+        sensBit(0x2) |  // $2X - TZC
+        sensBit(0x3) |  // $3X - Misc.
+        sensBit(0x4) |  // $4X - XBUSY
+                        // $5X - FOK
+        sensBit(0x6) |  // $6X - 0
+        sensBit(0x7) |  // $7X - 0
+        sensBit(0x8) |  // $8X - 0
+        sensBit(0x9) |  // $9X - 0
+                        // $AX - GFS
+                        // $BX - COMP
+                        // $CX - COUT
+        sensBit(0xD) |  // $DX - 0
+                        // $EX - OV64
+        sensBit(0xF);   // $FX - 0
     pseudoatomic<bool> m_soctEnabled;
 };
 }  // namespace picostation
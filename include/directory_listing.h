@@ -8,6 +8,7 @@ class DirectoryListing {
   public:
     
 	static void init();
+	static uint8_t checkAutoBoot(char *filePath);
 	static void gotoRoot();
     static bool gotoDirectory(const uint32_t index);
     static bool getPath(const uint32_t index, char* filePath);
@@ -24,20 +24,57 @@ class DiscImage {
     FRESULT load(const TCHAR *targetCue);
     void unload();
     SubQ::Data generateSubQ(const int sector);
-    bool hasData() { return m_hasData; };
+    bool hasData();
+    bool isAudioSector(const int sector);
+    bool lastReadRealTime() { return m_lastReadRealTime; }  // CD-DA or a real-time/Form 2 XA sector
     void makeDummyCue();
     void readSector(void *buffer, const int sector, DataLocation location, const uint16_t *scramling);
     void readSectorRAM(void *buffer, const int sector, const uint16_t *scramling);
     void readSectorSD(void *buffer, const int sector, const uint16_t *scramling);
+    bool readSectorRaw(uint8_t *raw, const int sector);  // see sector_worker.h
+    static bool needsEdc(const uint8_t *raw);
+    bool readUserData(void *buffer, const int lba);  // 2048 bytes of a Form 1 data track sector, unscrambled
+    uint32_t generation() const { return m_generation; }  // changes whenever a different image is set up
     void set_skip_bootsector(bool skip) { skip_bootsector =  skip; }
 	void set_skip_edc(bool skip) { skip_edc =  skip; }
 
   private:
-    CueDisc m_cueDisc;
-    bool m_hasData = false;
-    int m_currentLogicalTrack = 0;
+    // Track layout the TOC and SubQ are built from. Core0 reads it while core1 loads the next image, so it
+    // is copied out of m_cueDisc once the cue is fully parsed and published by swapping a pointer. A
+    // snapshot is never written while published, and only rewritten after both cores stopped reading it.
+    struct DiscMeta {
+        struct Track {
+            uint32_t start;   // index 0
+            uint32_t index1;
+            CueTrackType type;
+        };
+
+        int trackCount;
+        bool hasData;
+        Track tracks[MAXTRACK];  // numbered like CueDisc, trackCount + 1 is the lead-out
+    };
+
+    class MetaReader {
+      public:
+        explicit MetaReader(DiscImage &image);
+        ~MetaReader();
+        const DiscMeta *operator->() const { return m_meta; }
+
+      private:
+        DiscImage &m_image;
+        const DiscMeta *m_meta;
+    };
+
+    void publishMeta(const bool hasData);  // core1, after m_cueDisc changed
+
+    CueDisc m_cueDisc;  // core1 only
+    DiscMeta m_meta[2] = {};
+    DiscMeta *volatile m_publishedMeta = &m_meta[0];
+    volatile uint32_t m_metaReaders[2] = {0, 0};  // per core, nests with IRQs
+    volatile uint32_t m_generation = 0;
     bool skip_bootsector = false;
     bool skip_edc = false;
+    bool m_lastReadRealTime = false;
 };
 
 extern DiscImage g_discImage;
@@ -3,7 +3,8 @@
 #include <algorithm>
 #include <stdint.h>
 
-#include "pseudo_atomics.h"
+#include "hardware/sync.h"
+#include "seqlock.h"
 #include "values.h"
 
 namespace picostation {
@@ -11,37 +12,53 @@ class MechCommand;
 
 class DriveMechanics {
   public:
+    // What core1 and the SubQ/modchip code see of the drive, always as one consistent set
+    struct State {
+        uint32_t sector;
+        uint32_t skipSubq;  // sector of the last seek, until SubQ has skipped one report for it
+        bool sledWork;
+    };
+
+    void init();  // before core1 starts
+    void initSledTimer(const unsigned int slice, MechCommand &mechCommand);  // a PWM slice with no pin of its own
+    State getState() const { return m_state.read(); }
+
     void moveToNextSector();
     void setSector(uint32_t step, bool rev);
-    int getSector() { return m_sector; }
-    void moveSled(MechCommand &mechCommand);
+    int getSector() const { return getState().sector; }
     bool servo_valid();
-    void startSled();
-    void stopSled() { sled_work = false; }
-    uint32_t get_track_count() { return cur_track_counter;}
+    void startSled(bool rev);
+    void stopSled();
+    uint32_t get_track_count();
 	
-    void resetDrive()
-    {
-      sled_work = false;
-      m_sector = 0;
-      cur_track_counter = 0;
-      cur_zone = 0;
-      skip_subq = 0;
-    }
-
-    bool isSledStopped() { return !sled_work; }
+    void resetDrive();
+
+    // Track numbers count from sector 0, using the same zone layout as seeks
+    static uint32_t sectorToTrack(const uint32_t sector);
+    static uint32_t trackToSector(const uint32_t track);
+    static uint32_t sectorsPerTrack(const uint32_t sector);
+
+    bool isSledStopped() const { return !getState().sledWork; }
     
-    uint32_t req_skip_subq() { return skip_subq; }
-    void clear_skip_subq() { skip_subq = 0; }
+    uint32_t req_skip_subq() const { return getState().skipSubq; }
+    void clear_skip_subq();
     
   private:
+    // Writers come from the XLAT IRQ, the core0 loop and core1; readers only retry
+    template <typename F>
+    void update(F &&change);
+
+    static void sledWrapIrq();
+    void sledWrap();
+    uint32_t sledTracks();
+
 	uint32_t cur_track_counter = 0;
-    uint64_t m_sledTimer = 0;
-    uint32_t m_sector = 0;
-    uint8_t cur_zone = 0;
-    uint32_t c_MaxTrackMoveTime = 29; // WARNING don't change it
-    bool sled_work = false;
-    uint32_t skip_subq = 0;
+    unsigned int m_sledSlice = 0;
+    uint32_t m_sledTop = 0;
+    uint32_t m_sledWraps = 0;  // 256 tracks each
+    MechCommand *m_mechCommand = nullptr;
+    SeqLock<State> m_state;
+    spin_lock_t *m_writeLock = nullptr;
 };
 
 extern DriveMechanics g_driveMechanics;
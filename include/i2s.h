@@ -8,6 +8,8 @@
 #include "hardware/dma.h"
 #include "ff.h"
 #include "disc_image.h"
+#include "sector_cache.h"
+#include "sector_worker.h"
 
 #define CACHED_SECS		32 /* Only 2, 4, 8, 16, 32 */
 
@@ -22,28 +24,64 @@ class I2S {
     bool s_doorPending;
     
     void i2s_set_state(uint8_t state) { i2s_state = state; }
+    bool isStreaming() { return i2s_state; }
+
+    // core0: the head just landed on sector, core1 reads ahead of it while the DMA is idle
+    void prefetchHint(const int sector)
+    {
+        const uint32_t generation = (m_prefetchHint.Load() >> 24) + 1;
+        m_prefetchHint = (generation << 24) | (sector & 0xFFFFFF);
+    }
     int getSectorSending() { return m_sectorSending.Load(); }
     uint64_t getLastSectorTime() { return m_lastSectorTime.Load(); }
+	// core1
 	void reinitI2S() {
-		for (int i = 0; i < CACHED_SECS; i++) {
-			loadedSector[i] = -2;
-		}
-		lastSector = -1;
+		requestReinitI2S();
+		collectSectorJobs();  // drops the cache now
 		i2s_state = 0;
 	}
 
+	// core0, on a console reset. Core1 drops the cache and forgets the last sector when it sees the epoch
+	// change, along with any read-ahead core0's worker still has in hand, so nothing here waits for the
+	// worker that only core0 itself runs or writes what core1's loop is using.
+	void requestReinitI2S() { m_cacheEpoch = m_cacheEpoch.Load() + 1; }
+
+	// core0, on a short reset: the console reboots into the same image, so core1 keeps the cache and the ISO
+	// index and warms the boot sectors up again. It decides itself whether the cache still fits the image.
+	void warmResetI2S() { m_warmResets = m_warmResets.Load() + 1; }
+
+	// core0, on a long reset. Core1 unmounts the image and goes back to the menu on its next pass, so the
+	// disc layout and the listing keep a single writer.
+	void requestMenuReturn() { m_menuReturns = m_menuReturns.Load() + 1; }
+
     [[noreturn]] void start(MechCommand &mechCommand);
+    void onDmaComplete();  // core1 DMA IRQ
 	
   private:
     int initDMA(const volatile void *read_addr, unsigned int transfer_count);  // Returns DMA channel number
+    void collectSectorJobs();  // maps read-ahead sectors core0 finished
+    uint8_t allocateSlot(const uint8_t busySlot);
+    void sendSlot(const uint8_t slot);
     void mountSDCard();
 	
-	int loadedSector[CACHED_SECS];
+	SectorCache<CACHED_SECS> m_cache;
+	uint32_t m_cacheGeneration = 0;      // g_discImage.generation() the cache was filled under
+	pseudoatomic<uint32_t> m_cacheEpoch;  // bumped to drop the cache, read-ahead jobs carry the one they started in
+	uint32_t m_cacheEpochSeen = 0;        // core1, the epoch the cache was last dropped for
+	pseudoatomic<uint32_t> m_warmResets;  // core0 counts, core1 warms the boot sectors up again
+	pseudoatomic<uint32_t> m_menuReturns;  // core0 counts long resets, core1 unmounts
+	uint32_t (*m_samples)[1176];
+	volatile uint8_t m_dmaSlot;            // latest sector loaded, published by the loop for the DMA IRQ
+	volatile uint8_t m_sendingSlot;        // slot the DMA is reading, set by sendSlot
+	volatile uint32_t m_dmaPublishTime;
+	volatile int m_lastDmaSector;          // written by the DMA IRQ
+	volatile uint32_t m_lastDmaTime;
 	int lastSector;
 	uint8_t i2s_state = 0;
 	
     pseudoatomic<int> m_sectorSending;
     pseudoatomic<uint64_t> m_lastSectorTime;
+    pseudoatomic<uint32_t> m_prefetchHint;  // generation << 24 | sector
 };
 }  // namespace picostation
 
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Extents of every file and directory on the mounted image's ISO9660 data track, built at mount. Lets
+// read-ahead follow a file to its end, and names the sectors the BIOS reads first (PVD, root directory,
+// SYSTEM.CNF and the boot executable) so they can be cached before it asks. Core1 only.
+
+namespace picostation {
+
+class IsoIndex {
+  public:
+    struct Extent {
+        uint32_t lba : 24;
+        uint32_t directory : 1;
+        uint32_t sectors;
+    };
+
+    void build();  // after g_discImage.load
+    void clear() { m_count = 0; m_warmCount = 0; }
+
+    const Extent *find(const int lba) const;  // extent containing lba, if any
+    size_t warmupSectors(int *lbas, const size_t max) const;  // in the order the BIOS reads them
+
+  private:
+    static constexpr size_t c_maxExtents = 512;
+    static constexpr size_t c_maxDirectorySectors = 16;  // bigger directories are only partly indexed
+    static constexpr size_t c_maxWarmup = 4;              // PVD, root directory, SYSTEM.CNF, executable
+
+    bool findEntry(const Extent &directory, const char *name, const size_t nameLength, Extent &entry);
+    void addDirectory(const Extent &directory);
+    size_t bootPath(const Extent &systemCnf, char *path, const size_t max);
+
+    Extent m_extents[c_maxExtents];
+    size_t m_count = 0;
+    Extent m_warm[c_maxWarmup];
+    size_t m_warmCount = 0;
+};
+
+extern IsoIndex g_isoIndex;
+}  // namespace picostation
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Sectors of the menu loader, a raw 2352 byte/sector image in flash. Reading them through XIP as the console
+// asks thrashes the XIP cache, so the next sector is streamed into RAM by DMA from the SSI stream FIFO while
+// the current one is sent, and the sectors read most stay pinned in RAM. Core1 only.
+//
+// With LOADER_COMPRESSED the image is embedded as written by tools/host/loader_pack: a header, the offset of
+// every sector's block from the start of the image, then one LZ4 block per sector, padded to 4 bytes. A block
+// of a whole sector is stored uncompressed. Only the sector asked for is decoded.
+
+namespace picostation {
+
+class LoaderStream {
+  public:
+    static constexpr size_t c_sectorBytes = 2352;
+
+    struct PackedHeader {
+        static constexpr uint32_t c_magic = 'L' | 'Z' << 8 | 'S' << 16 | '1' << 24;
+        uint32_t magic;
+        uint32_t sectorCount;
+        // uint32_t offsets[sectorCount + 1] follow, the last one is the image size
+    };
+
+    void init();
+
+    uint32_t sectorCount() const { return m_sectorCount; }
+    void read(uint32_t *buffer, const uint32_t index, const uint16_t *scrambling);  // index < sectorCount()
+
+  private:
+    static constexpr size_t c_stageSlots = 2;   // the one being read and the one streaming in
+    static constexpr size_t c_pinnedSlots = 4;
+    static constexpr size_t c_maxSectors = 128;  // read counts kept for the first 128, the loader is ~87
+    static constexpr uint32_t c_noSector = UINT32_MAX;
+
+    struct Slot {
+        uint32_t index = c_noSector;
+        uint32_t size = 0;  // of the block held, a whole sector when it isn't compressed
+        alignas(4) uint8_t data[c_sectorBytes];
+    };
+
+    const uint8_t *flashBlock(const uint32_t index, uint32_t &size) const;
+    const uint8_t *sectorData(const uint8_t *block, const uint32_t size);
+    void stage(const uint32_t index, const size_t keepSlot);
+    void finishStream();
+    void pin(const uint32_t index, const uint8_t *data);
+#if LOADER_BENCHMARK
+    void benchmark();
+#endif
+
+    Slot m_stage[c_stageSlots];
+    Slot m_pinned[c_pinnedSlots];
+    uint8_t m_reads[c_maxSectors] = {};
+    uint32_t m_sectorCount = 0;
+#if LOADER_COMPRESSED
+    const uint32_t *m_offsets = nullptr;
+    alignas(4) uint8_t m_decoded[c_sectorBytes];
+#endif
+    int m_channel = -1;  // -1 when the image isn't in flash, it is then read in place
+    int m_streaming = -1;  // stage slot the DMA is filling
+};
+
+extern LoaderStream g_loaderStream;
+}  // namespace picostation
@@ -0,0 +1,20 @@
+#ifndef _LZ4_BLOCK_H
+#define _LZ4_BLOCK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Decodes one LZ4 block (the raw block format, no frame header) of a known decoded size. The block may be
+// followed by padding, decoding stops once dstSize bytes are out. False for a corrupt block.
+bool lz4_decode_block(const uint8_t *src, size_t srcSize, uint8_t *dst, size_t dstSize);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
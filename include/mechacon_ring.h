@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Bytes the mechacon state machine shifted in, copied from its RX FIFO into a small ring by DMA, so no
+// IRQ runs per byte and a burst of SENS selects between two latches can't overflow the FIFO. A latch
+// only needs the last 3. Core0 only.
+
+namespace picostation {
+
+class MechaconRing {
+  public:
+    void start();  // after mechacon_program_init
+
+    uint32_t received();                   // bytes so far, wraps
+    uint8_t byte(const uint32_t index) const  // index < received(), only the last c_size are kept
+    {
+        return m_words[index & (c_size - 1)] >> 24;
+    }
+
+  private:
+    static constexpr size_t c_size = 8;
+
+    alignas(c_size * sizeof(uint32_t)) volatile uint32_t m_words[c_size] = {};
+    int m_channel = -1;
+    uint32_t m_base = 0;  // bytes received before the transfer count was last rewound
+};
+
+extern MechaconRing g_mechaconRing;
+}  // namespace picostation
@@ -3,6 +3,7 @@
 #include <stdint.h>
 
 #include "cmd.h"
+#include "pico/time.h"
 
 namespace picostation {
 class MechCommand;
@@ -10,10 +11,28 @@ class MechCommand;
 class ModChip {
   public:
     void init();
-    void sendLicenseString(const int sector, MechCommand &mechCommand);
+    void sendLicenseString(const int sector, MechCommand &mechCommand);  // core1 loop, never blocks
 
   private:
+    enum class State : uint8_t {
+        IDLE,     // counting hysteresis on core1
+        GAP,      // 90ms of silence before the next string, watched for abort
+        SENDING,  // DMA feeding the UART
+        DONE,     // sequence over, core1 still has to finish it
+    };
+
+    static int64_t alarmCallback(alarm_id_t id, void *user_data);
+    int64_t step();
+    bool conditionsHold() const;
+    void startString();
     void endLicenseSequence();
+
+    MechCommand *m_mechCommand = nullptr;
+    volatile State m_state = State::IDLE;  // IDLE and DONE belong to core1, GAP and SENDING to the alarm
+    int m_stringIndex = 0;
+    int m_dmaChannel = -1;
+    uint32_t m_stringTimeUs = 0;  // four frames at the baud rate the UART actually got
+    uint64_t m_gapEnd = 0;
     uint64_t m_modchipTimer;
 };
-}  // namespace picostation
\ No newline at end of file
+}  // namespace picostation
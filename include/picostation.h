@@ -1,6 +1,7 @@
 #include "hardware/pwm.h"
 #include "pico/multicore.h"
 #include "pseudo_atomics.h"
+#include "spsc_queue.h"
 
 namespace picostation {
 
@@ -22,11 +23,22 @@ enum class FileListingStates {
     MOUNT_FILE,
     PROCESS_FILES,
     GET_COVER,
-    GET_CFG
+    GET_COVER_ART,
+    GET_CFG,
+    GET_STATS
 };
 
 extern pseudoatomic<FileListingStates> g_fileListingState;
-extern pseudoatomic<uint32_t> g_fileArg;
+
+// Menu commands from core0's mechacon handling to the core1 menu state machine, in order and none lost
+struct MenuCommand {
+    FileListingStates action;
+    uint32_t arg;
+};
+extern SpscQueue<MenuCommand, 8> g_menuCommands;  // not empty: the menu sectors are stale until it drains
+// Custom commands latched by the XLAT IRQ and handed on by core0's loop; they differ while one is in between
+extern pseudoatomic<uint32_t> g_menuCommandsLatched;
+extern pseudoatomic<uint32_t> g_menuCommandsQueued;
 
 struct PWMSettings {
     const unsigned int gpio;
@@ -52,6 +64,7 @@ extern unsigned int g_audioCtrlMode;
 [[noreturn]] void core1Entry();  // I2S, sdcard, modchip
 
 void initHW();
+void bootConsole();  // after core1 is launched
 void updatePlaybackSpeed();
 void reset();
 void do_reset(uint32_t sleepMS);
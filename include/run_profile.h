@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "global.h"
+
+// Learns which sector runs a game reads and in what order from the request stream, and keeps them in a
+// .hnt file next to the cue. On later boots a request landing on a known run predicts the rest of it,
+// and the end of a run predicts the start of the one usually read next. Core1 only.
+
+namespace picostation {
+
+class RunProfile {
+  public:
+    struct Prediction {
+        int start;         // [start, end) is worth reading ahead, empty if start == end
+        int end;
+        bool followsHead;  // read it just in front of the requests rather than all at once
+    };
+
+    void open(const char *cuePath);
+    void close();
+    Prediction record(const int sector);  // every sector request while a game is mounted
+    void flushIfIdle();                   // only once the spindle has been stopped for a while
+
+  private:
+    static constexpr uint32_t c_fileMagic = 0x544E4850;  // "PHNT"
+    static constexpr uint16_t c_fileVersion = 1;
+    static constexpr size_t c_maxRuns = 128;
+    static constexpr uint16_t c_noRun = 0xFFFF;
+
+    struct Run {
+        uint32_t start;
+        uint16_t length;
+        uint16_t next;  // run usually read after this one
+        uint16_t hits;
+        uint16_t reserved;
+    };
+    static_assert(sizeof(Run) == 12, "runs are written to the hints file as-is");
+
+    struct FileHeader {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t count;
+    };
+
+    uint16_t findRun(const int sector) const;
+    void closeRun();
+    uint16_t storeRun(const uint32_t start, const uint32_t end);
+    void save();
+
+    Run m_runs[c_maxRuns];
+    uint16_t m_count = 0;
+    char m_path[c_maxFilePathLength + 1];
+    bool m_open = false;
+    bool m_dirty = false;
+    uint64_t m_dirtySince = 0;
+
+    int m_runStart = -1;
+    int m_lastSector = -1;
+    uint16_t m_lastRun = c_noRun;     // last run read to the end, for ordering
+    uint16_t m_currentRun = c_noRun;  // known run the requests are in
+};
+
+extern RunProfile g_runProfile;
+}  // namespace picostation
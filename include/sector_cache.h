@@ -0,0 +1,116 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Slot bookkeeping for the I2S sector cache. The sample buffers themselves stay with the owner;
+// this only tracks which sector lives in which slot and which slot to refill next.
+// No SDK dependencies, so tools/host/cache_sim.cpp runs this exact code against recorded traces.
+
+namespace picostation {
+
+template <size_t MaxSlots>
+class SectorCache {
+    static_assert(MaxSlots >= 2 && (MaxSlots & (MaxSlots - 1)) == 0, "slot count must be a power of 2");
+
+  public:
+    static constexpr int c_emptySlot = -2;
+
+    enum class Replacement : uint8_t {
+        NEXT_FREE,  // firmware default: refill the last loaded slot unless it is being sent
+        FIFO,       // strict round robin over all slots
+        LRU,        // least recently loaded or hit
+    };
+
+    SectorCache() { invalidate(); }
+
+    void setCapacity(const size_t slots) { m_mask = ((slots <= MaxSlots) ? slots : MaxSlots) - 1; }
+    void setReplacement(const Replacement replacement) { m_replacement = replacement; }
+    size_t capacity() const { return m_mask + 1; }
+
+    void invalidate()
+    {
+        for (size_t i = 0; i < MaxSlots; i++)
+        {
+            m_sectors[i] = c_emptySlot;
+            m_lastUse[i] = 0;
+        }
+        m_nextSlot = 0;
+        m_useClock = 0;
+    }
+
+    // Returns the slot holding sector, or -1
+    int find(const int sector)
+    {
+        for (size_t i = 0; i <= m_mask; i++)
+        {
+            if (m_sectors[i] == sector)
+            {
+                m_lastUse[i] = ++m_useClock;
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    // Picks the slot to load the next sector into, never the one published for sending next nor the one
+    // still on the wire (the same slot unless a sector is being sent while the next one is loaded)
+    size_t allocate(const size_t busySlot, const size_t sendingSlot)
+    {
+        const auto busy = [&](const size_t slot) { return slot == busySlot || slot == sendingSlot; };
+
+        switch (m_replacement)
+        {
+            case Replacement::FIFO:
+                m_nextSlot = (m_nextSlot + 1) & m_mask;
+                for (size_t i = 0; i < m_mask && busy(m_nextSlot); i++)
+                {
+                    m_nextSlot = (m_nextSlot + 1) & m_mask;
+                }
+                break;
+
+            case Replacement::LRU:
+            {
+                uint32_t oldest = UINT32_MAX;
+                for (size_t i = 0; i <= m_mask; i++)
+                {
+                    if (!busy(i) && m_lastUse[i] < oldest)
+                    {
+                        oldest = m_lastUse[i];
+                        m_nextSlot = i;
+                    }
+                }
+                break;
+            }
+
+            case Replacement::NEXT_FREE:
+            default:
+                for (size_t i = 0; i < m_mask && busy(m_nextSlot); i++)
+                {
+                    m_nextSlot = (m_nextSlot + 1) & m_mask;
+                }
+                break;
+        }
+
+        return m_nextSlot;
+    }
+    size_t allocate(const size_t busySlot) { return allocate(busySlot, busySlot); }
+
+    void assign(const size_t slot, const int sector)
+    {
+        m_sectors[slot] = sector;
+        m_lastUse[slot] = ++m_useClock;
+    }
+
+    int sector(const size_t slot) const { return m_sectors[slot]; }
+
+  private:
+    int m_sectors[MaxSlots];
+    uint32_t m_lastUse[MaxSlots];
+    size_t m_mask = MaxSlots - 1;
+    size_t m_nextSlot = 0;
+    uint32_t m_useClock = 0;
+    Replacement m_replacement = Replacement::NEXT_FREE;
+};
+
+}  // namespace picostation
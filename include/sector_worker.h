@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "spsc_queue.h"
+
+// Hands the CPU half of a read-ahead sector to core0: core1 reads the raw sector from the card and
+// queues it, core0 regenerates EDC/ECC and scrambles it into the I2S buffer in short stages between
+// its own work, and core1 maps the finished buffer into the cache while it is already reading the
+// next sector.
+
+namespace picostation {
+
+struct SectorJob {
+    alignas(4) uint8_t raw[2352];  // unscrambled sector as stored on the card
+    uint32_t *samples;             // I2S buffer to fill
+    const uint16_t *scrambling;
+    int sector;
+    uint32_t epoch;  // I2S cache epoch at submit, a job from before a cache drop isn't mapped
+    uint8_t slot;
+};
+
+class SectorWorker {
+  public:
+    static constexpr size_t c_jobs = 2;  // one being read on core1, one being worked on core0
+
+    // core1
+    SectorJob *acquire();  // free job, or nullptr if all are in flight
+    void submit(SectorJob *job)
+    {
+        m_submitted.push(job);
+        __sev();  // core0 may be asleep
+    }
+    SectorJob *collect();  // a finished job, free again once the caller returns to the loop
+    void release(SectorJob *job) { m_busy[job - m_jobs] = false; }  // acquired but not submitted
+    bool inFlight(const int sector) const;
+    bool slotInFlight(const uint8_t slot) const;
+    bool busy() const;
+
+    // core0, one stage per call so sled and SOCT handling are never held up for long
+    void run();
+    bool pending() const { return m_current || !m_submitted.empty(); }
+
+  private:
+    static constexpr size_t c_scrambleStages = 4;
+
+    SectorJob m_jobs[c_jobs];
+    bool m_busy[c_jobs] = {};  // core1 only
+    SpscQueue<SectorJob *, c_jobs> m_submitted;
+    SpscQueue<SectorJob *, c_jobs> m_finished;
+
+    SectorJob *m_current = nullptr;  // core0 only
+    size_t m_stage = 0;
+};
+
+extern SectorWorker g_sectorWorker;
+}  // namespace picostation
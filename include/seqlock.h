@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "hardware/sync.h"
+
+// Sequence lock for a small value written on one core and read on both. Readers never block: they
+// copy the value and retry if a write was in progress or happened meanwhile. Writers have to be
+// serialized by the caller, e.g. with a hardware spinlock taken with interrupts off.
+
+namespace picostation {
+
+template <typename T>
+class SeqLock {
+  public:
+    T read() const
+    {
+        T value;
+        uint32_t sequence;
+        do
+        {
+            sequence = m_sequence;
+            __dmb();
+            value = m_value;
+            __dmb();
+        } while ((sequence & 1) || sequence != m_sequence);
+        return value;
+    }
+
+    void write(const T &value)
+    {
+        m_sequence = m_sequence + 1;  // odd while the value is being written
+        __dmb();
+        m_value = value;
+        __dmb();
+        m_sequence = m_sequence + 1;
+    }
+
+  private:
+    T m_value = {};
+    volatile uint32_t m_sequence = 0;
+};
+}  // namespace picostation
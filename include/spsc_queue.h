@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hardware/sync.h"
+
+// Lock-free ring between exactly one producer and one consumer, e.g. one on each core. Each index is
+// written by one side only; the barriers order the slot access against the index update, so no
+// spinlock is needed.
+
+namespace picostation {
+
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of 2");
+
+  public:
+    // Producer only, false if full
+    bool push(const T &item)
+    {
+        const uint32_t head = m_head;
+        if (head - m_tail == Capacity)
+        {
+            return false;
+        }
+
+        m_items[head & (Capacity - 1)] = item;
+        __dmb();
+        m_head = head + 1;
+        return true;
+    }
+
+    // Consumer only, false if empty
+    bool pop(T &item)
+    {
+        const uint32_t tail = m_tail;
+        if (tail == m_head)
+        {
+            return false;
+        }
+
+        __dmb();
+        item = m_items[tail & (Capacity - 1)];
+        __dmb();
+        m_tail = tail + 1;
+        return true;
+    }
+
+    bool empty() const { return m_head == m_tail; }
+    size_t size() const { return m_head - m_tail; }
+
+  private:
+    T m_items[Capacity];
+    volatile uint32_t m_head = 0;  // written by the producer
+    volatile uint32_t m_tail = 0;  // written by the consumer
+};
+}  // namespace picostation
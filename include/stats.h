@@ -0,0 +1,97 @@
+#ifndef _STATS_H
+#define _STATS_H
+
+#include <stdint.h>
+
+#include "pico/platform.h"
+
+// Runtime counters, always enabled. Each core only touches its own copy so an update is a plain
+// increment; the menu reads the combined snapshot through a synthetic sector (see stats_read_sector).
+
+#define STATS_LATENCY_BUCKETS 8  // <0.5ms, <1ms, <2ms, <4ms, <8ms, <16ms, <32ms, longer
+
+typedef struct
+{
+	uint32_t cacheHits;
+	uint32_t cacheMisses;
+	uint32_t readLatency[STATS_LATENCY_BUCKETS];
+	uint32_t worstReadUs;
+	uint32_t deadlineMisses;  // DMA for the next sector started later than one sector period
+	uint32_t seeks;
+	uint32_t seekSectors;
+	uint32_t longestSeek;
+	uint32_t edcRegenerations;
+	uint32_t sdTokenTimeouts;  // block reads the card never sent the data token for
+	uint32_t sdErrors;         // failed block reads, those and rejected read commands
+	uint32_t subqAlarms;
+	uint32_t subqLateUs;
+	uint32_t subqWorstLateUs;
+	uint32_t prefetchReads;  // sectors read ahead, after seek landings, along known runs and files
+	uint32_t warmupReads;    // boot sectors cached at mount
+	uint32_t concealedSectors;  // audio sectors replayed because the next one was read too late
+	uint32_t streamSectors;     // sectors requested while a CD-DA or real-time XA stream played
+	uint32_t workerSectors;     // read-ahead sectors finished by the core0 worker
+	uint32_t core0WorstResponseUs;  // SOCT FIFO or sector sent until core0 handled it
+	uint32_t menuCommandDrops;      // menu commands lost because core1 fell 8 behind
+	uint32_t mechDeferredDrops;     // mechacon commands whose deferred part core0 had no room for
+	uint32_t loaderStagedReads;     // loader sectors already streamed into RAM when asked for
+	uint32_t loaderPinnedReads;     // loader sectors served from the pinned, most read ones
+	uint32_t loaderFlashReads;      // loader sectors read through XIP, after a jump
+	uint32_t loaderXipAccesses;     // XIP cache accesses of those flash reads
+	uint32_t loaderXipHits;         // and how many of them hit
+	uint32_t loaderBenchDecodeUs;   // LOADER_BENCHMARK: at power-on, decoding every loader sector from a cold XIP cache
+	uint32_t loaderBenchXipUs;      // against reading as many raw sectors through it
+} stats_counters_t;
+
+// Power-on phases, each stamped once with the time it ended (us since boot). Not reset with the counters;
+// the stats sector carries them after the counter block.
+typedef enum
+{
+	BOOT_PHASE_CLOCKS,      // clock generator set up
+	BOOT_PHASE_HW,          // initHW done, core1 launched next
+	BOOT_PHASE_CONSOLE,     // console reset pulse and settling, core0's IRQs live
+	BOOT_PHASE_SD_MOUNT,    // core1, alongside the console reset
+	BOOT_PHASE_AUTOBOOT,    // root directory checked for an auto boot image
+	BOOT_PHASE_IMAGE,       // auto boot image or the menu's dummy cue set up
+	BOOT_PHASE_LISTING,     // first directory listing built (after the image when auto booting)
+	BOOT_PHASE_MENU_READ,   // the loader first read the listing sector
+	BOOT_PHASE_COUNT
+} boot_phase_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern stats_counters_t g_stats[2];
+
+#define STATS_INC(field) (g_stats[get_core_num()].field++)
+#define STATS_ADD(field, value) (g_stats[get_core_num()].field += (value))
+#define STATS_MAX(field, value)                               \
+	do                                                        \
+	{                                                         \
+		stats_counters_t *s_ = &g_stats[get_core_num()];      \
+		if ((uint32_t) (value) > s_->field)                   \
+		{                                                     \
+			s_->field = (value);                              \
+		}                                                     \
+	} while (0)
+
+static inline void stats_read_latency(const uint32_t us)
+{
+	const uint32_t scaled = us >> 9;
+	const uint32_t bucket = scaled ? 32 - __builtin_clz(scaled) : 0;
+
+	g_stats[get_core_num()].readLatency[(bucket < STATS_LATENCY_BUCKETS) ? bucket : STATS_LATENCY_BUCKETS - 1]++;
+	STATS_MAX(worstReadUs, us);
+}
+
+void stats_reset(void);
+void stats_boot_phase(boot_phase_t phase);
+void stats_snapshot(void);        // core1, on EXTENDED_GET_STATS
+uint16_t *stats_read_sector(void);  // user data for the stats menu sector
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Sector/command trace recorder. Records are queued into a RAM ring per core and written to
+// c_traceFileName on the SD card once the spindle has stopped, or between reads when a ring is nearly
+// full. Build with -DTRACE_RECORDER=ON.
+// The record layout below is shared with the host decoder in tools/host.
+
+#ifndef TRACE_RECORDER
+#define TRACE_RECORDER 0
+#endif
+
+namespace picostation {
+namespace Trace {
+
+constexpr uint32_t c_fileMagic = 0x43525450;  // "PTRC"
+constexpr uint16_t c_fileVersion = 1;
+
+enum Event : uint8_t {
+    EVENT_NONE = 0,
+    EVENT_SECTOR_REQUEST = 1,  // logged once loaded: arg0 = sector, arg1 = read time (us), flags = FLAG_CACHE_HIT
+    EVENT_SECTOR_DMA = 2,      // arg0 = sector, arg1 = us since the sector was requested
+    EVENT_MECH_COMMAND = 3,    // arg0 = raw 24 bit latch
+    EVENT_SEEK = 4,            // arg0 = old sector, arg1 = new sector, aux = tracks, flags = FLAG_REVERSE
+    EVENT_SLED_START = 5,      // arg0 = sector, flags = FLAG_REVERSE
+    EVENT_SLED_STOP = 6,       // arg0 = sector, arg1 = tracks counted
+    EVENT_DROPPED = 7,         // arg0 = records lost to a full ring, aux = core
+};
+
+enum Flags : uint8_t {
+    FLAG_CACHE_HIT = 1 << 0,
+    FLAG_REVERSE = 1 << 1,
+};
+
+struct Record {
+    uint32_t timestamp;  // time_us_32()
+    uint8_t event;
+    uint8_t flags;
+    uint16_t aux;
+    uint32_t arg0;
+    uint32_t arg1;
+};
+static_assert(sizeof(Record) == 16, "trace records are written to disk as-is");
+
+struct FileHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t recordSize;
+};
+static_assert(sizeof(FileHeader) == 8, "trace header is written to disk as-is");
+
+}  // namespace Trace
+
+#if TRACE_RECORDER
+class TraceRecorder {
+  public:
+    void record(const uint8_t event, const uint8_t flags, const uint16_t aux, const uint32_t arg0,
+                const uint32_t arg1);
+    void flush(const bool driveIdle);  // core1 only, call when no sector is due
+
+  private:
+    static constexpr size_t c_ringSize = 256;  // per core, power of 2
+
+    struct Ring {
+        Trace::Record records[c_ringSize];
+        volatile uint32_t head = 0;  // written by the producing core
+        volatile uint32_t tail = 0;  // written by core1 while flushing
+        volatile uint32_t dropped = 0;
+    };
+
+    bool openFile();
+    void drain(Ring &ring, const uint16_t core);
+
+    Ring m_rings[2];
+    bool m_fileOpen = false;
+    bool m_fileFailed = false;
+};
+
+extern TraceRecorder g_traceRecorder;
+#endif
+}  // namespace picostation
+
+#if TRACE_RECORDER
+#define TRACE_EVENT(...) picostation::g_traceRecorder.record(__VA_ARGS__)
+#define TRACE_FLUSH(driveIdle) picostation::g_traceRecorder.flush(driveIdle)
+#else
+#define TRACE_EVENT(...) do { } while (0)
+#define TRACE_FLUSH(driveIdle) do { } while (0)
+#endif
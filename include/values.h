@@ -66,7 +66,7 @@ enum : unsigned int {
 
 namespace PIOInstance {
 PIO const I2S_DATA = pio0;
-PIO const MECHACON = pio0;
+PIO const MECHACON = pio1;  // pio0 has no room for the SENS select
 PIO const SOCT = pio0;
 PIO const SUBQ = pio0;
 }  // namespace PIOInstance
@@ -74,9 +74,10 @@ PIO const SUBQ = pio0;
 namespace SM {
 // PIO0
 constexpr uint32_t I2S_DATA = 0;
-constexpr uint32_t MECHACON = 1;
 constexpr uint32_t SOCT = 2;
 constexpr uint32_t SUBQ = 3;
+// PIO1, the controller sniffer has 0 and 1
+constexpr uint32_t MECHACON = 2;
 }  // namespace SM
 
 constexpr int c_leadIn = 4500;
@@ -87,7 +88,11 @@ extern int c_sectorMax;
 
 //uint32_t c_MaxTrackMoveTime = 15;//35714;//139;
 constexpr uint32_t c_MaxSubqDelayTime = 3333;  // uS
+constexpr uint32_t c_sectorPeriodUs = 13333;  // uS at 1x, 588 LRCK periods at 44.1kHz
+constexpr uint32_t c_sectorDeadlineSlackUs = 500;  // uS
+constexpr int c_landingSlack = 32;  // seeks land a little before the sector the console wants
 
 
 constexpr size_t c_cdSamplesSize = 588;
 constexpr size_t c_cdSamplesBytes = c_cdSamplesSize * 2 * 2;  // 2352
+constexpr size_t c_cdScrambleLength = c_cdSamplesBytes / 2;   // scramble_data length of a sector, in 16-bit words
@@ -7,11 +7,15 @@
 #include "i2s.h"
 #include "drive_mechanics.h"
 #include "hardware/pio.h"
+#include "hardware/sync.h"
 #include "logging.h"
 #include "main.pio.h"
+#include "mechacon_ring.h"
 #include "pico/bootrom.h"
 #include "picostation.h"
 #include "pseudo_atomics.h"
+#include "stats.h"
+#include "trace.h"
 #include "values.h"
 #include "directory_listing.h"
 
@@ -21,9 +25,6 @@
 #define DEBUG_PRINT(...) while (0)
 #endif
 extern picostation::I2S m_i2s;
-extern pseudoatomic<uint32_t> g_fileArg;
-extern pseudoatomic<picostation::FileListingStates> needFileCheckAction;
-extern pseudoatomic<int> listReadyState;
 
 static bool dir = 0;
 static bool trk_dir = 0;
@@ -31,11 +32,20 @@ static bool prev_dir = 0;
 static bool sled_break = 0;
 static uint16_t m_jumpTrack = 0;
 
+static void __time_critical_func(queueMenuCommand)(const picostation::FileListingStates action, const uint32_t arg)
+{
+	if (!picostation::g_menuCommands.push({action, arg}))
+	{
+		STATS_INC(menuCommandDrops);
+	}
+}
+
 void __time_critical_func(picostation::MechCommand::processLatchedCommand)()
 {
     static mech_cmd command;
     command.raw = m_latched;
     m_latched = 0;
+    TRACE_EVENT(Trace::EVENT_MECH_COMMAND, 0, 0, command.raw, 0);
     
 	switch (command.cmd.id)
     {
@@ -62,7 +72,7 @@ void __time_critical_func(picostation::MechCommand::processLatchedCommand)()
 					DEBUG_PRINT("SLED FORWARD\n");
 					dir = 0;
 					m_i2s.i2s_set_state(0);
-					g_driveMechanics.startSled();
+					g_driveMechanics.startSled(dir);
 					break;
 				}
 
@@ -71,7 +81,7 @@ void __time_critical_func(picostation::MechCommand::processLatchedCommand)()
 					DEBUG_PRINT("SLED REVERSE\n");
 					dir = 1;
 					m_i2s.i2s_set_state(0);
-					g_driveMechanics.startSled();
+					g_driveMechanics.startSled(dir);
 					break;
 				}
 			}
@@ -92,12 +102,7 @@ void __time_critical_func(picostation::MechCommand::processLatchedCommand)()
 					setSens(SENS::FOK, true);
 					m_i2s.i2s_set_state(0);
 					setSens(SENS::XBUSY, true);
-					add_alarm_in_ms(15, [](alarm_id_t id, void *user_data) -> int64_t 
-					{
-						picostation::MechCommand *mechCommand = static_cast<picostation::MechCommand *>(user_data);
-						mechCommand->resetXBUSY();
-						return 0;
-					}, this, true);
+					deferCommand(command);  // XBUSY clears 15ms later
 					break;
 
 				case ASEQ_CMD_1TRK_JUMP:
@@ -125,10 +130,7 @@ void __time_critical_func(picostation::MechCommand::processLatchedCommand)()
 			
 			if (command.mode_specification.SOCT)
 			{
-				pio_sm_set_enabled(PIOInstance::SUBQ, SM::SUBQ, false);
-				soct_program_init(PIOInstance::SOCT, SM::SOCT, g_soctOffset, Pin::SQSO, Pin::SQCK);
-				pio_sm_set_enabled(PIOInstance::SOCT, SM::SOCT, true);
-				pio_sm_put_blocking(PIOInstance::SOCT, SM::SOCT, 0xFFFFFFF);
+				deferCommand(command);  // SOCT state machine restart
 			}
 			break;
 		}
@@ -172,126 +174,191 @@ void __time_critical_func(picostation::MechCommand::processLatchedCommand)()
 		
 		case MECH_CMD_CUSTOM:
 		{
-			g_fileArg = command.custom_cmd.arg;
+			deferCommand(command);
+			break;
+		}
+		
+		default:
+			if (!((1 << command.cmd.id) & 0x6A))
+			{
+				deferCommand(command);
+			}
+			break;
+	}
+}
 
-			switch (command.custom_cmd.cmd)
+void __time_critical_func(picostation::MechCommand::deferCommand)(const mech_cmd &command)
+{
+	if (!m_deferred.push(command.raw))
+	{
+		STATS_INC(mechDeferredDrops);
+	}
+	else if (command.cmd.id == MECH_CMD_CUSTOM && command.custom_cmd.cmd != COMMAND_NONE)
+	{
+		// The listing on offer is stale from here, not only once core0's loop has queued the command
+		g_menuCommandsLatched = g_menuCommandsLatched.Load() + 1;
+	}
+}
+
+// The part of each command the console doesn't wait for, run from core0's loop so the XLAT IRQ stays short
+void __time_critical_func(picostation::MechCommand::processDeferredCommands)()
+{
+	uint32_t raw;
+	while (m_deferred.pop(raw))
+	{
+		mech_cmd command;
+		command.raw = raw;
+
+		switch (command.cmd.id)
+		{
+			case MECH_CMD_AUTO_SEQUENCE:
 			{
-				case COMMAND_NONE:
-				{
-					needFileCheckAction = FileListingStates::IDLE;
-					break;
-				}
-					
-				case COMMAND_GOTO_ROOT:
-				{
-					DEBUG_PRINT("GOTO_ROOT\n");
-					needFileCheckAction = FileListingStates::GOTO_ROOT;
-					listReadyState = 0;
-					break;
-				}
-					
-				case COMMAND_GOTO_PARENT:
-				{
-					DEBUG_PRINT("GOTO_PARENT\n");
-					needFileCheckAction = FileListingStates::GOTO_PARENT;
-					listReadyState = 0;
-					break;
-				}
-					
-				case COMMAND_GOTO_DIRECTORY:
-				{
-					DEBUG_PRINT("GOTO_DIRECTORY\n");
-					needFileCheckAction = FileListingStates::GOTO_DIRECTORY;
-					listReadyState = 0;
-					break;
-				}
-					
-				case COMMAND_GET_NEXT_CONTENTS:
-				{
-					DEBUG_PRINT("GET_NEXT_CONTENTS\n");
-					needFileCheckAction = FileListingStates::GET_NEXT_CONTENTS;
-					listReadyState = 0;
-					break;
-				}
-					
-				case COMMAND_MOUNT_FILE:
+				if (command.aseq_cmd.cmd == ASEQ_CMD_FOCUS_ON)
 				{
-					DEBUG_PRINT("MOUNT_FILE\n");
-					needFileCheckAction = FileListingStates::MOUNT_FILE;
-					break;
+					add_alarm_in_ms(15, [](alarm_id_t id, void *user_data) -> int64_t 
+					{
+						picostation::MechCommand *mechCommand = static_cast<picostation::MechCommand *>(user_data);
+						mechCommand->resetXBUSY();
+						return 0;
+					}, this, true);
 				}
-					
-				case COMMAND_IO_COMMAND:
+				break;
+			}
+			
+			case MECH_CMD_MODE_SPECIFICATION:
+			{
+				// Unless the console turned it off again meanwhile
+				if (command.mode_specification.SOCT && getSoct())
 				{
-					DEBUG_PRINT("COMMAND_IO_COMMAND %x\n", command.custom_cmd.arg);
-					break;
+					pio_sm_set_enabled(PIOInstance::SUBQ, SM::SUBQ, false);
+					soct_program_init(PIOInstance::SOCT, SM::SOCT, g_soctOffset, Pin::SQSO, Pin::SQCK);
+					pio_sm_set_enabled(PIOInstance::SOCT, SM::SOCT, true);
+					pio_sm_put_blocking(PIOInstance::SOCT, SM::SOCT, 0xFFFFFFF);
 				}
-					
-				case COMMAND_IO_DATA:
-				{
-					DEBUG_PRINT("COMMAND_IO_DATA %x\n", command.custom_cmd.arg);
-					break;
-				}
-				
-				case COMMAND_EXTENDED:
+				break;
+			}
+			
+			case MECH_CMD_CUSTOM:
+			{
+				switch (command.custom_cmd.cmd)
 				{
-					switch (command.custom_cmd.arg >> 1)
+					case COMMAND_NONE:
 					{
-						case EXTENDED_SKIP_BOOTSECTOR:
-							g_discImage.set_skip_bootsector(command.custom_cmd.arg & 1);
-							break;
+						// Back to idle, without touching listReadyState
+						queueMenuCommand(FileListingStates::IDLE, command.custom_cmd.arg);
+						break;
+					}
 						
-						case EXTENDED_SKIP_EDC:
-							g_discImage.set_skip_edc(command.custom_cmd.arg & 1);
-							break;
+					case COMMAND_GOTO_ROOT:
+					{
+						DEBUG_PRINT("GOTO_ROOT\n");
+						queueMenuCommand(FileListingStates::GOTO_ROOT, command.custom_cmd.arg);
+						break;
+					}
 						
-						case EXTENDED_GET_CFG:
-							needFileCheckAction = FileListingStates::GET_CFG;
-							listReadyState = 0;
-							break;
+					case COMMAND_GOTO_PARENT:
+					{
+						DEBUG_PRINT("GOTO_PARENT\n");
+						queueMenuCommand(FileListingStates::GOTO_PARENT, command.custom_cmd.arg);
+						break;
+					}
 						
-						default:
-							break;
+					case COMMAND_GOTO_DIRECTORY:
+					{
+						DEBUG_PRINT("GOTO_DIRECTORY\n");
+						queueMenuCommand(FileListingStates::GOTO_DIRECTORY, command.custom_cmd.arg);
+						break;
+					}
+						
+					case COMMAND_GET_NEXT_CONTENTS:
+					{
+						DEBUG_PRINT("GET_NEXT_CONTENTS\n");
+						queueMenuCommand(FileListingStates::GET_NEXT_CONTENTS, command.custom_cmd.arg);
+						break;
+					}
+						
+					case COMMAND_MOUNT_FILE:
+					{
+						DEBUG_PRINT("MOUNT_FILE\n");
+						queueMenuCommand(FileListingStates::MOUNT_FILE, command.custom_cmd.arg);
+						break;
+					}
+						
+					case COMMAND_IO_COMMAND:
+					{
+						DEBUG_PRINT("COMMAND_IO_COMMAND %x\n", command.custom_cmd.arg);
+						break;
+					}
+						
+					case COMMAND_IO_DATA:
+					{
+						DEBUG_PRINT("COMMAND_IO_DATA %x\n", command.custom_cmd.arg);
+						break;
+					}
+					
+					case COMMAND_EXTENDED:
+					{
+						switch (command.custom_cmd.arg >> 1)
+						{
+							case EXTENDED_SKIP_BOOTSECTOR:
+								g_discImage.set_skip_bootsector(command.custom_cmd.arg & 1);
+								break;
+							
+							case EXTENDED_SKIP_EDC:
+								g_discImage.set_skip_edc(command.custom_cmd.arg & 1);
+								break;
+							
+							case EXTENDED_GET_CFG:
+								queueMenuCommand(FileListingStates::GET_CFG, command.custom_cmd.arg);
+								break;
+							
+							case EXTENDED_GET_STATS:
+								queueMenuCommand(FileListingStates::GET_STATS, command.custom_cmd.arg);
+								break;
+							
+							default:
+								break;
+						}
+						break;
+					}
+					
+					case COMMAND_GET_COVER:
+					{
+						queueMenuCommand(FileListingStates::GET_COVER, command.custom_cmd.arg);
+						break;
 					}
-					break;
-				}
-				
-				case COMMAND_GET_COVER:
-				{
-					needFileCheckAction = FileListingStates::GET_COVER;
-					listReadyState = 0;
-					break;
-				}
 
                 case COMMAND_GET_COVER_ART:
-				{
-					needFileCheckAction = FileListingStates::GET_COVER_ART;
-					listReadyState = 0;
-					break;
-				}
-				
-				case COMMAND_BOOTLOADER:
-				{
-					if (command.custom_cmd.arg == 0xBEEF)
 					{
-						// Restart into bootloader
-						rom_reset_usb_boot_extra(Pin::LED, 0, false);
+						queueMenuCommand(FileListingStates::GET_COVER_ART, command.custom_cmd.arg);
+						break;
 					}
-					break;
+					
+					case COMMAND_BOOTLOADER:
+					{
+						if (command.custom_cmd.arg == 0xBEEF)
+						{
+							// Restart into bootloader
+							rom_reset_usb_boot_extra(Pin::LED, 0, false);
+						}
+						break;
+					}
+					
+					default:
+						break;
 				}
-				
-				default:
-					break;
+				if (command.custom_cmd.cmd != COMMAND_NONE)
+				{
+					// After the push, so core1 never sees the counts match with the command in neither place
+					g_menuCommandsQueued = g_menuCommandsQueued.Load() + 1;
+				}
+				break;
 			}
-			break;
-		}
-		
-		default:
-			if (!((1 << command.cmd.id) & 0x6A))
-			{
+			
+			default:
 				setBootSectorPattern(command.cmd.id);
-			}
-			break;
+				break;
+		}
 	}
 }
 
@@ -339,15 +406,26 @@ void __time_critical_func(picostation::MechCommand::setBootSectorPattern) (uint8
 	}
 }
 
-bool __time_critical_func(picostation::MechCommand::getSens)(const size_t what) const { return m_sensData[what]; }
+bool __time_critical_func(picostation::MechCommand::getSens)(const size_t what) const { return m_sensMask & sensBit(what); }
 
 void __time_critical_func(picostation::MechCommand::setSens)(const size_t what, const bool new_value)
 {
-    m_sensData[what] = new_value;
-    if (what == m_currentSens)
+    // XLAT IRQ and the core0 loop both change bits
+    const uint32_t irqState = save_and_disable_interrupts();
+    m_sensMask = new_value ? (m_sensMask | sensBit(what)) : (m_sensMask & ~sensBit(what));
+    refreshSens();
+    restore_interrupts(irqState);
+}
+
+// The state machine only looks at the mask once per byte, so when the console keeps polling the same
+// address, the new level has to be driven from here
+void __time_critical_func(picostation::MechCommand::refreshSens)()
+{
+    do
     {
-        gpio_put(Pin::SENS, new_value);
-    }
+        updateMech();
+        pio_sm_exec(PIOInstance::MECHACON, SM::MECHACON, pio_encode_set(pio_pins, getSens(m_currentSens)));
+    } while (g_mechaconRing.received() != m_bytesSeen);  // a byte finished meanwhile
 }
 
 bool picostation::MechCommand::getSoct() { return m_soctEnabled.Load(); }
@@ -361,13 +439,16 @@ void __time_critical_func(picostation::MechCommand::resetXBUSY)()
 
 void __time_critical_func(picostation::MechCommand::updateMech)() 
 {
-    while (pio_sm_get_rx_fifo_level(PIOInstance::MECHACON, SM::MECHACON))
+    // Only the last 3 bytes make up a command
+    const uint32_t received = g_mechaconRing.received();
+    uint32_t next = ((received - m_bytesSeen) > 3) ? received - 3 : m_bytesSeen;
+    for (; next != received; next++)
     {
-        const uint32_t c = pio_sm_get_blocking(PIOInstance::MECHACON, SM::MECHACON) >> 24;
+        const uint32_t c = g_mechaconRing.byte(next);
         m_latched = m_latched >> 8;
         m_latched = m_latched | (c << 16);
         m_currentSens = c >> 4;
     }
-    gpio_put(Pin::SENS, m_sensData[m_currentSens]);
+    m_bytesSeen = received;
 }
 
@@ -11,6 +11,7 @@
 #include "ff.h"
 #include "listingBuilder.h"
 #include "logging.h"
+#include "stats.h"
 
 #if DEBUG_FILEIO
 #define DEBUG_PRINT(...) printf(__VA_ARGS__)
@@ -100,6 +101,7 @@ uint8_t __time_critical_func(DirectoryListing::checkAutoBoot)(char *filePath)
 	if (FR_OK == fr){
 		sd_present = true;
 	}
+    stats_boot_phase(BOOT_PHASE_SD_MOUNT);
     gotoRoot();
     if(!sd_present) return 0;
 
@@ -7,6 +7,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include "ff.h"
+#include "hardware/sync.h"
+#include "loader_stream.h"
 #include "logging.h"
 #include "picostation.h"
 #include "subq.h"
@@ -14,6 +16,7 @@
 #include "values.h"
 #include "global.h"
 #include "edc.h"
+#include "stats.h"
 
 #if DEBUG_CUE
 #define DEBUG_PRINT(...) printf(__VA_ARGS__)
@@ -21,9 +24,6 @@
 #define DEBUG_PRINT(...) while (0)
 #endif
 
-extern const uint8_t  loaderImage[];
-extern const uint32_t loaderImageSize;
-
 struct MSF
 {
     int mm;
@@ -82,6 +82,19 @@ static MSF __time_critical_func(sectorToMSF)(const int sector)
     return msf;
 }
 
+// Byte of the raw sector back out of a scrambled I2S buffer, see scramble_data
+static inline uint8_t __time_critical_func(unscrambledByte)(const uint32_t *samples, const uint16_t *scramling, const size_t offset)
+{
+    const uint16_t word = ((samples[offset / 2] >> 8) & 0xFFFF) ^ scramling[offset / 2];
+    return (offset & 1) ? (word >> 8) : (word & 0xFF);
+}
+
+// XA audio and video streams must arrive at a steady rate, file data can wait
+static inline bool __time_critical_func(isRealTime)(const uint8_t mode, const uint8_t submode)
+{
+    return mode == 2 && (submode & (Submode::RealTime | Submode::Form));
+}
+
 static inline int toBCD(const int in)
 {
     if (in > 99)
@@ -187,15 +200,16 @@ void __time_critical_func(picostation::DiscImage::buildSector)(const int sector,
 
 picostation::SubQ::Data __time_critical_func(picostation::DiscImage::generateSubQ)(const int sector)
 {
+    const MetaReader meta(*this);
     SubQ::Data subqdata;
 
     int sector_track;
 
     if (sector < c_leadIn)  // Lead-in area
     {
-        const int point = (((sector - 1) / 3) % (3 + m_cueDisc.trackCount)) + 1;  // TOC entries are repeated 3 times
+        const int point = (((sector - 1) / 3) % (3 + meta->trackCount)) + 1;  // TOC entries are repeated 3 times
 
-        if (point <= m_cueDisc.trackCount)  // TOC Entries
+        if (point <= meta->trackCount)  // TOC Entries
         {
             const int logical_track = point;
             if (logical_track == 1)
@@ -206,44 +220,44 @@ picostation::SubQ::Data __time_critical_func(picostation::DiscImage::generateSub
             else 
             {
                 // Offset each track by track 1's pre-gap
-                sector_track = m_cueDisc.tracks[logical_track].indices[1] + c_preGap;
+                sector_track = meta->tracks[logical_track].index1 + c_preGap;
             }
             
             const MSF msf_track = sectorToMSF(sector_track);
 
             subqdata.ctrladdr =
-                (m_cueDisc.tracks[logical_track].trackType == CueTrackType::TRACK_TYPE_DATA) ? 0x41 : 0x01;
+                (meta->tracks[logical_track].type == CueTrackType::TRACK_TYPE_DATA) ? 0x41 : 0x01;
             subqdata.tno = 0x00;
             subqdata.x = toBCD(logical_track);
             subqdata.pmin = toBCD(msf_track.mm);
             subqdata.psec = toBCD(msf_track.ss);
             subqdata.pframe = toBCD(msf_track.ff);
         } 
-        else if (point == m_cueDisc.trackCount + 1)  // A0 - Report first track number
+        else if (point == meta->trackCount + 1)  // A0 - Report first track number
         {
-            subqdata.ctrladdr = m_cueDisc.tracks[1].trackType == CueTrackType::TRACK_TYPE_DATA ? 0x41 : 0x01;
+            subqdata.ctrladdr = meta->tracks[1].type == CueTrackType::TRACK_TYPE_DATA ? 0x41 : 0x01;
             subqdata.tno = 0x00;
             subqdata.point = 0xA0;
             subqdata.pmin = 0x01;
-            subqdata.psec = m_hasData ? 0x20 : 0x00;  // 0 = audio, 20 = CDROM-XA
+            subqdata.psec = meta->hasData ? 0x20 : 0x00;  // 0 = audio, 20 = CDROM-XA
             subqdata.pframe = 0x00;
         } 
-        else if (point == m_cueDisc.trackCount + 2)  // A1 - Report last track number
+        else if (point == meta->trackCount + 2)  // A1 - Report last track number
         {
             // Thanks rama! )
-            subqdata.ctrladdr = m_cueDisc.tracks[m_cueDisc.trackCount].trackType == CueTrackType::TRACK_TYPE_DATA ? 0x41 : 0x01;
+            subqdata.ctrladdr = meta->tracks[meta->trackCount].type == CueTrackType::TRACK_TYPE_DATA ? 0x41 : 0x01;
             subqdata.tno = 0x00;
             subqdata.point = 0xA1;
-            subqdata.pmin = toBCD(m_cueDisc.trackCount);
+            subqdata.pmin = toBCD(meta->trackCount);
             subqdata.psec = 0x00;
             subqdata.pframe = 0x00;
         } 
-        else if (point == m_cueDisc.trackCount + 3)  // A2 - Report lead-out track location
+        else if (point == meta->trackCount + 3)  // A2 - Report lead-out track location
         {
             // <3
-            const int sector_lead_out = m_cueDisc.tracks[m_cueDisc.trackCount + 1].indices[1] + c_preGap;
+            const int sector_lead_out = meta->tracks[meta->trackCount + 1].index1 + c_preGap;
             const MSF msf_lead_out = sectorToMSF(sector_lead_out);
-            subqdata.ctrladdr = m_cueDisc.tracks[m_cueDisc.trackCount].trackType == CueTrackType::TRACK_TYPE_DATA ? 0x41 : 0x01;
+            subqdata.ctrladdr = meta->tracks[meta->trackCount].type == CueTrackType::TRACK_TYPE_DATA ? 0x41 : 0x01;
             subqdata.tno = 0x00;
             subqdata.point = 0xA2;
             subqdata.pmin = toBCD(msf_lead_out.mm);
@@ -259,38 +273,38 @@ picostation::SubQ::Data __time_critical_func(picostation::DiscImage::generateSub
     } 
     else  // Program area + lead-out
     {
-        m_currentLogicalTrack = m_cueDisc.trackCount + 1;  // in case seek overshoots past end of disc
+        int currentLogicalTrack = meta->trackCount + 1;  // in case seek overshoots past end of disc
 
         if (sector - c_leadIn < c_preGap)
         {
-            m_currentLogicalTrack = 1;
+            currentLogicalTrack = 1;
         } 
         else
         {
-            for (size_t i = 1; i < m_cueDisc.trackCount + 2; i++)   // + 2 for lead in & lead out
+            for (size_t i = 1; i < meta->trackCount + 2; i++)   // + 2 for lead in & lead out
 			{
-                if (m_cueDisc.tracks[i + 1].indices[0] > sector - c_leadIn - c_preGap) 
+                if (meta->tracks[i + 1].start > sector - c_leadIn - c_preGap) 
                 {
-                    m_currentLogicalTrack = i;
+                    currentLogicalTrack = i;
                     break;
                 }
             }
         }
-        sector_track = sector - m_cueDisc.tracks[m_currentLogicalTrack].indices[1] - c_leadIn - c_preGap;
+        sector_track = sector - meta->tracks[currentLogicalTrack].index1 - c_leadIn - c_preGap;
         const MSF msf_track = sectorToMSF(sector_track);
 
         const int sector_abs = (sector - c_leadIn) + 1;
         const MSF msf_abs = sectorToMSF(sector_abs);
 
-        subqdata.ctrladdr = (m_cueDisc.tracks[m_currentLogicalTrack].trackType == CueTrackType::TRACK_TYPE_DATA) ? 0x41 : 0x01;
+        subqdata.ctrladdr = (meta->tracks[currentLogicalTrack].type == CueTrackType::TRACK_TYPE_DATA) ? 0x41 : 0x01;
 
-        if (m_currentLogicalTrack == m_cueDisc.trackCount + 1)
+        if (currentLogicalTrack == meta->trackCount + 1)
         {
             subqdata.tno = 0xAA;  // Lead-out track
         } 
         else
         {
-            subqdata.tno = toBCD(m_currentLogicalTrack);  // Track numbers
+            subqdata.tno = toBCD(currentLogicalTrack);  // Track numbers
         }
 
         if (sector_track < 0)					   // 2 sec pause track
@@ -387,6 +401,8 @@ static struct CueFile *__time_critical_func(fileopen)(struct CueFile *file, stru
 
 FRESULT __time_critical_func(picostation::DiscImage::load)(const TCHAR *targetCue)
 {
+    m_generation = m_generation + 1;
+
     // To-do: Need alternate code paths here for parsing cue from alternate sources.
     struct CueScheduler scheduler;
     Scheduler_construct(&scheduler);
@@ -416,17 +432,18 @@ FRESULT __time_critical_func(picostation::DiscImage::load)(const TCHAR *targetCu
     m_cueDisc.tracks[m_cueDisc.trackCount + 1].indices[0] = m_cueDisc.tracks[m_cueDisc.trackCount + 1].fileOffset;
     m_cueDisc.tracks[m_cueDisc.trackCount + 1].indices[1] = m_cueDisc.tracks[m_cueDisc.trackCount + 1].indices[0];
 
-    m_hasData = false;
+    bool hasData = false;
     DEBUG_PRINT("Track\tStart\tLength\tPregap\n");
     for (size_t i = 0; i <= m_cueDisc.trackCount + 1; i++)
     {
         if (m_cueDisc.tracks[i].trackType == CueTrackType::TRACK_TYPE_DATA)
         {
-            m_hasData = true;
+            hasData = true;
         }
         DEBUG_PRINT("%d\t%d\t%d\t%d\n", i, m_cueDisc.tracks[i].indices[0], m_cueDisc.tracks[i].size,
 										   m_cueDisc.tracks[i].indices[1] - m_cueDisc.tracks[i].indices[0]);
     }
+    publishMeta(hasData);
     
     c_sectorMax = m_cueDisc.tracks[m_cueDisc.trackCount+1].indices[0] + 4652;
     
@@ -435,6 +452,7 @@ FRESULT __time_critical_func(picostation::DiscImage::load)(const TCHAR *targetCu
 
 void __time_critical_func(picostation::DiscImage::unload)()
 {
+	m_generation = m_generation + 1;
 	DEBUG_PRINT("Close:\nTrack\tStart\tLength\tPregap\n");
 	if (m_cueDisc.trackCount == 1 || m_cueDisc.tracks[1].file->opaque == m_cueDisc.tracks[2].file->opaque)
 	{
@@ -460,6 +478,8 @@ void __time_critical_func(picostation::DiscImage::makeDummyCue)()
 {
     // Create a dummy cue disc with a single data track, as well as lead-in and lead-out tracks.
 
+    m_generation = m_generation + 1;
+
     constexpr uint32_t c_sectorCount = (98 * 75 * 60) + (57 * 75) + 74;  // 98:57:74(mm:ss:ff) leaving room for 2 sec pre-gap and lead-in
 
     m_cueDisc.trackCount = 1;
@@ -482,7 +502,7 @@ void __time_critical_func(picostation::DiscImage::makeDummyCue)()
     m_cueDisc.tracks[2].indices[0] = m_cueDisc.tracks[2].fileOffset;
     m_cueDisc.tracks[2].indices[1] = m_cueDisc.tracks[2].indices[0];
 
-    m_hasData = true;
+    publishMeta(true);
 
     DEBUG_PRINT("Track\tStart\tLength\tPregap\n");
     for (size_t i = 0; i <= m_cueDisc.trackCount + 1; i++)
@@ -511,14 +531,113 @@ void __time_critical_func(picostation::DiscImage::readSector)(void *buffer, cons
     }
 }
 
+// Form 2 EDC is optional and has no ECC, only Form 1 needs regenerating
+bool __time_critical_func(picostation::DiscImage::needsEdc)(const uint8_t *raw)
+{
+    return raw[15] != 2 || !(raw[18] & Submode::Form);
+}
+
+// Data track sectors that need EDC regeneration, read unscrambled so the work can be done elsewhere.
+// False for everything readSectorSD builds or streams as is.
+bool __time_critical_func(picostation::DiscImage::readSectorRaw)(uint8_t *raw, const int sector)
+{
+    const int adjustedSector = sector - c_preGap;
+    if (skip_edc || (!skip_bootsector && adjustedSector < 5) || adjustedSector < 0)
+    {
+        return false;
+    }
+
+    for (size_t i = 1; i <= m_cueDisc.trackCount; i++)
+    {
+        if (adjustedSector < m_cueDisc.tracks[i + 1].indices[0])
+        {
+            FIL *file = (FIL *)m_cueDisc.tracks[i].file->opaque;
+            if (!file || m_cueDisc.tracks[i].trackType != CueTrackType::TRACK_TYPE_DATA ||
+                adjustedSector < m_cueDisc.tracks[i].fileOffset)
+            {
+                return false;
+            }
+
+            UINT br = 0;
+            if (f_lseek(file, (int64_t)(adjustedSector - m_cueDisc.tracks[i].fileOffset) * c_cdSamplesBytes) != FR_OK ||
+                f_read(file, raw, c_cdSamplesBytes, &br) != FR_OK || br < c_cdSamplesBytes)
+            {
+                return false;
+            }
+
+            m_lastReadRealTime = isRealTime(raw[15], raw[18]);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool __time_critical_func(picostation::DiscImage::isAudioSector)(const int sector)
+{
+    const MetaReader meta(*this);
+    const int adjustedSector = sector - c_preGap;
+    for (int i = 1; i <= meta->trackCount; i++)
+    {
+        if (adjustedSector < (int)meta->tracks[i + 1].start)
+        {
+            return adjustedSector >= 0 && meta->tracks[i].type == CueTrackType::TRACK_TYPE_AUDIO;
+        }
+    }
+    return false;
+}
+
+bool __time_critical_func(picostation::DiscImage::hasData)()
+{
+    const MetaReader meta(*this);
+    return meta->hasData;
+}
+
+// Readers count themselves in before loading the pointer, so the writer either sees them or they see
+// the new snapshot
+__force_inline picostation::DiscImage::MetaReader::MetaReader(DiscImage &image) : m_image(image)
+{
+    m_image.m_metaReaders[get_core_num()]++;
+    __dmb();
+    m_meta = m_image.m_publishedMeta;
+}
+
+__force_inline picostation::DiscImage::MetaReader::~MetaReader()
+{
+    __dmb();
+    m_image.m_metaReaders[get_core_num()]--;
+}
+
+void picostation::DiscImage::publishMeta(const bool hasData)
+{
+    DiscMeta *next = (m_publishedMeta == &m_meta[0]) ? &m_meta[1] : &m_meta[0];
+
+    next->trackCount = m_cueDisc.trackCount;
+    next->hasData = hasData;
+    for (int i = 0; i <= m_cueDisc.trackCount + 1 && i < MAXTRACK; i++)
+    {
+        next->tracks[i] = {m_cueDisc.tracks[i].indices[0], m_cueDisc.tracks[i].indices[1], m_cueDisc.tracks[i].trackType};
+    }
+
+    __dmb();
+    m_publishedMeta = next;
+    __dmb();
+
+    // Grace period: once the other core has been outside a reader, nothing holds the old snapshot and the
+    // next publish may overwrite it. Readers on this core are IRQs, which finished before we got here.
+    const unsigned int other = get_core_num() ^ 1;
+    while (m_metaReaders[other])
+    {
+        tight_loop_contents();
+    }
+}
+
 void __time_critical_func(picostation::DiscImage::readSectorRAM)(void *buffer, const int sector, const uint16_t *scramling)
 {
     const int adjustedSector = sector - c_preGap;
-    size_t targetOffset = adjustedSector * c_cdSamplesBytes;
     
-    if (targetOffset >= 0 && targetOffset <= loaderImageSize - c_cdSamplesBytes)
+    if (adjustedSector >= 0 && (uint32_t) adjustedSector < g_loaderStream.sectorCount())
     {
-		scramble_data((uint32_t *) buffer, (uint16_t *) &loaderImage[targetOffset], scramling, 1176);
+		g_loaderStream.read((uint32_t *) buffer, adjustedSector, scramling);
     } 
     else
     {
@@ -533,10 +652,18 @@ void __time_critical_func(picostation::DiscImage::readSectorSD)(void *buffer, co
 	size_t i;
 
 	const int adjustedSector = sector - c_preGap;
+	m_lastReadRealTime = false;
     
     if (!skip_bootsector && adjustedSector >= 0 && adjustedSector < 5 && m_cueDisc.tracks[1].trackType == CueTrackType::TRACK_TYPE_DATA)
 	{
-		scramble_data((uint32_t *) buffer, (uint16_t *) &loaderImage[adjustedSector * 2352], scramling, 1176);
+		if ((uint32_t) adjustedSector < g_loaderStream.sectorCount())
+		{
+			g_loaderStream.read((uint32_t *) buffer, adjustedSector, scramling);
+		}
+		else
+		{
+			buildSector(sector, static_cast<uint32_t *>(buffer), NULL, scramling, false);
+		}
 		return;
 	}
 
@@ -579,6 +706,16 @@ void __time_critical_func(picostation::DiscImage::readSectorSD)(void *buffer, co
 					{
 						DEBUG_PRINT("f_read error: (%d)\n",  fr);
 					}
+
+					if (m_cueDisc.tracks[i].trackType != CueTrackType::TRACK_TYPE_DATA)
+					{
+						m_lastReadRealTime = true;
+					}
+					else
+					{
+						const uint32_t *samples = static_cast<const uint32_t *>(buffer);
+						m_lastReadRealTime = isRealTime(unscrambledByte(samples, scramling, 15), unscrambledByte(samples, scramling, 18));
+					}
 				}
 				else
 				{
@@ -588,9 +725,16 @@ void __time_critical_func(picostation::DiscImage::readSectorSD)(void *buffer, co
 						DEBUG_PRINT("f_read error: (%d)\n",  fr);
 					}
 					
-					eccedc_generate((uint8_t *) s_userData);
+					const uint8_t *raw = (const uint8_t *) s_userData;
+					m_lastReadRealTime = isRealTime(raw[15], raw[18]);
+
+					if (needsEdc(raw))
+					{
+						eccedc_generate((uint8_t *) s_userData);
+						STATS_INC(edcRegenerations);
+					}
 					
-					scramble_data((uint32_t *) buffer, s_userData, scramling, c_cdSamplesBytes/2);
+					scramble_data((uint32_t *) buffer, s_userData, scramling, c_cdScrambleLength);
                 }
                 break;
             }
@@ -609,3 +753,25 @@ is_pregap:
     }
 }
 
+bool __time_critical_func(picostation::DiscImage::readUserData)(void *buffer, const int lba)
+{
+	if (m_cueDisc.tracks[1].trackType != CueTrackType::TRACK_TYPE_DATA || !m_cueDisc.tracks[1].file->opaque ||
+		lba < 0 || lba >= m_cueDisc.tracks[2].indices[0])
+	{
+		return false;
+	}
+
+	FIL *file = (FIL *)m_cueDisc.tracks[1].file->opaque;
+	UINT br = 0;
+	if (f_lseek(file, (int64_t)(lba - m_cueDisc.tracks[1].fileOffset) * c_cdSamplesBytes) != FR_OK ||
+		f_read(file, s_userData, c_cdSamplesBytes, &br) != FR_OK || br < c_cdSamplesBytes)
+	{
+		DEBUG_PRINT("readUserData failed (%d)\n", lba);
+		return false;
+	}
+
+	// Mode 1 data follows the header, Mode 2 Form 1 the subheader as well
+	const uint8_t *raw = (const uint8_t *)s_userData;
+	memcpy(buffer, raw + ((raw[15] == 1) ? 16 : 24), 2048);
+	return true;
+}
@@ -1,10 +1,16 @@
 #include "drive_mechanics.h"
 
 #include <algorithm>
+#include <array>
 #include <math.h>
 #include <stdio.h>
+#include "hardware/clocks.h"
+#include "hardware/irq.h"
+#include "hardware/pwm.h"
 #include "i2s.h"
 #include "cmd.h"
+#include "stats.h"
+#include "trace.h"
 #include "values.h"
 #include "logging.h"
 
@@ -15,135 +21,234 @@
 #endif
 
 #define ZONE_CNT 	16
-#define ZONE_MAX 	ZONE_CNT-1
+
+// Sled speed while the console kicks it; the old polling loop advanced one track per >29us, keep that rate
+static constexpr uint32_t c_sledTrackTimeUs = 30;
+
+// The sled timer divides the system clock by 256 and wraps once per COUT period
+static constexpr uint32_t c_sledClockDiv = 256;
+static constexpr uint32_t c_tracksPerCout = 256;
 
 extern picostation::I2S m_i2s;
-uint32_t zone[ZONE_CNT] = 			{4500, 7750, 13500, 27000, 45000, 63000, 85500, 103500, 130500, 153000, 175500, 207000, 234000, 265500, 297000, 999999};
-uint32_t sect_per_track[ZONE_CNT] = {	8,    9,    10,    11,    12,    13,    14,     15,     16,     17,     18,     19,     20,     21,     22,     23};
+
+// zone[] holds the first sector past each zone
+static constexpr uint32_t zone[ZONE_CNT] = 			{4500, 7750, 13500, 27000, 45000, 63000, 85500, 103500, 130500, 153000, 175500, 207000, 234000, 265500, 297000, 999999};
+static constexpr uint32_t sect_per_track[ZONE_CNT] = {	8,    9,    10,    11,    12,    13,    14,     15,     16,     17,     18,     19,     20,     21,     22,     23};
+
+// First track of each zone, a partial last track still counts as one
+static constexpr std::array<uint32_t, ZONE_CNT> c_zoneFirstTrack = []() {
+	std::array<uint32_t, ZONE_CNT> first{};
+	for (size_t i = 1; i < ZONE_CNT; i++)
+	{
+		const uint32_t sectors = zone[i - 1] - ((i > 1) ? zone[i - 2] : 0);
+		first[i] = first[i - 1] + (sectors + sect_per_track[i - 1] - 1) / sect_per_track[i - 1];
+	}
+	return first;
+}();
+
+static inline uint32_t zoneStart(const size_t z) { return z ? zone[z - 1] : 0; }
+
+static inline size_t zoneOfSector(const uint32_t sector)
+{
+	const size_t z = std::upper_bound(zone, zone + ZONE_CNT, sector) - zone;
+	return std::min<size_t>(z, ZONE_CNT - 1);
+}
+
+static inline size_t zoneOfTrack(const uint32_t track)
+{
+	return (std::upper_bound(c_zoneFirstTrack.begin(), c_zoneFirstTrack.end(), track) - c_zoneFirstTrack.begin()) - 1;
+}
 
 picostation::DriveMechanics picostation::g_driveMechanics;
 
-void __time_critical_func(picostation::DriveMechanics::moveToNextSector)()
+void picostation::DriveMechanics::init()
 {
-	if(m_sector < c_sectorMax){
-		m_sector++;
+	m_writeLock = spin_lock_init(spin_lock_claim_unused(true));
+}
+
+// Counts sled tracks in hardware. With the clock divided by 256, one wrap of a counter topping out at
+// the cycles per track is 256 tracks, and its IRQ makes the COUT edge.
+void picostation::DriveMechanics::initSledTimer(const unsigned int slice, MechCommand &mechCommand)
+{
+	m_sledSlice = slice;
+	m_mechCommand = &mechCommand;
+	m_sledTop = (uint32_t)(((uint64_t)clock_get_hz(clk_sys) * c_sledTrackTimeUs * c_tracksPerCout) /
+						   (1000000U * c_sledClockDiv)) - 1;
+
+	pwm_config config = pwm_get_default_config();
+	pwm_config_set_clkdiv_mode(&config, PWM_DIV_FREE_RUNNING);
+	pwm_config_set_clkdiv_int(&config, c_sledClockDiv);
+	pwm_config_set_wrap(&config, m_sledTop);
+	pwm_init(m_sledSlice, &config, false);
+
+	pwm_clear_irq(m_sledSlice);
+	pwm_set_irq_enabled(m_sledSlice, true);
+	irq_set_exclusive_handler(PWM_IRQ_WRAP, sledWrapIrq);
+	irq_set_enabled(PWM_IRQ_WRAP, true);
+}
+
+void __time_critical_func(picostation::DriveMechanics::sledWrapIrq)()
+{
+	g_driveMechanics.sledWrap();
+}
+
+void __time_critical_func(picostation::DriveMechanics::sledWrap)()
+{
+	pwm_clear_irq(m_sledSlice);
+	m_sledWraps++;
+
+	// COUT toggles once per 256 tracks crossed
+	m_mechCommand->setSens(SENS::COUT, !m_mechCommand->getSens(SENS::COUT));
+}
+
+// Tracks since startSled, with IRQs off. A wrap that hasn't been serviced yet still counts.
+uint32_t __time_critical_func(picostation::DriveMechanics::sledTracks)()
+{
+	const uint32_t mask = 1u << m_sledSlice;
+	const bool wrappedBefore = pwm_get_irq_status_mask() & mask;
+	uint32_t count = pwm_get_counter(m_sledSlice);
+	const bool wrapped = pwm_get_irq_status_mask() & mask;
+	if (wrapped && !wrappedBefore)
+	{
+		count = pwm_get_counter(m_sledSlice);  // wrapped between the reads
 	}
-	
-	if (m_sector > zone[cur_zone] && cur_zone < ZONE_MAX)
+
+	return (m_sledWraps + wrapped) * c_tracksPerCout + (count * c_tracksPerCout) / (m_sledTop + 1);
+}
+
+template <typename F>
+inline void __time_critical_func(picostation::DriveMechanics::update)(F &&change)
+{
+	const uint32_t irqState = spin_lock_blocking(m_writeLock);
+	State state = m_state.read();
+	change(state);
+	m_state.write(state);
+	spin_unlock(m_writeLock, irqState);
+}
+
+uint32_t __time_critical_func(picostation::DriveMechanics::sectorToTrack)(const uint32_t sector)
+{
+	const size_t z = zoneOfSector(sector);
+	return c_zoneFirstTrack[z] + (sector - zoneStart(z)) / sect_per_track[z];
+}
+
+uint32_t __time_critical_func(picostation::DriveMechanics::trackToSector)(const uint32_t track)
+{
+	const size_t z = zoneOfTrack(track);
+	return zoneStart(z) + (track - c_zoneFirstTrack[z]) * sect_per_track[z];
+}
+
+uint32_t __time_critical_func(picostation::DriveMechanics::sectorsPerTrack)(const uint32_t sector)
+{
+	return sect_per_track[zoneOfSector(sector)];
+}
+
+void __time_critical_func(picostation::DriveMechanics::moveToNextSector)()
+{
+	update([](State &state) {
+		if (state.sector < (uint32_t)c_sectorMax)
+		{
+			state.sector++;
+		}
+	});
+}
+
+void __time_critical_func(picostation::DriveMechanics::resetDrive)()
+{
+	if (m_mechCommand)
 	{
-		cur_zone++;
+		pwm_set_enabled(m_sledSlice, false);
+		pwm_clear_irq(m_sledSlice);
 	}
+	update([](State &state) { state = {0, 0, false}; });
+	cur_track_counter = 0;
+}
+
+void __time_critical_func(picostation::DriveMechanics::clear_skip_subq)()
+{
+	update([](State &state) { state.skipSubq = 0; });
 }
 
 void __time_critical_func(picostation::DriveMechanics::setSector)(uint32_t step, bool rev)
 {
 	m_i2s.i2s_set_state(0);
+	uint32_t fromSector = 0;
+	uint32_t toSector = 0;
 
-	while(step != 0)
-	{
-        if(rev == 0)
-        {
-            uint32_t sbze = zone[cur_zone] - m_sector;
-            uint32_t sbreq = step * sect_per_track[cur_zone];
-            uint32_t do_steps = ((sbze > sbreq) ? sbreq : sbze) / sect_per_track[cur_zone];
-            m_sector += do_steps * sect_per_track[cur_zone];
-            
-            if(m_sector > c_sectorMax)
-            {
-                static uint32_t last_sector_max = 0;
-                static uint8_t last_zone_max = 0;
-
-                if (!last_sector_max || last_sector_max != m_sector)
-                {
-                    last_sector_max = m_sector;
-                    for (last_zone_max = 0; last_zone_max <= ZONE_MAX; last_zone_max++)
-                    {
-                        if (zone[last_zone_max] > c_sectorMax)
-                        {
-                            last_zone_max--;
-                            break;
-                        }
-                    }
-                }
-
-                m_sector = c_sectorMax;
-                cur_zone = last_zone_max;
-                break;
-            }
-            
-            step -= do_steps;
-            if(step > 0 && cur_zone < ZONE_MAX)
-            {
-                cur_zone++;
-            }
-        }
-        else
-        {
-            uint32_t sect_before_ze;
-            uint32_t do_steps;
-            uint32_t req_sect_step = step * sect_per_track[cur_zone];
-
-            if(cur_zone > 0)
-            {
-                sect_before_ze = m_sector - zone[cur_zone - 1];
-            }
-            else
-            {
-                sect_before_ze = req_sect_step;
-            }
-
-            do_steps = ((sect_before_ze > req_sect_step) ? req_sect_step : sect_before_ze) / sect_per_track[cur_zone];
-            
-            if(m_sector > (do_steps * sect_per_track[cur_zone]))
-            {
-                m_sector -= do_steps * sect_per_track[cur_zone];
-            }
-            else
-            {
-                m_sector = 0;
-                cur_zone = 0;
-                break;
-            }
-            
-			step -= do_steps;
-           
-			if((cur_zone > 0) && (step > 0))
-			{
-                cur_zone--;
-            }
-        }
-	}
-	
-	skip_subq = m_sector;
+	update([&](State &state) {
+		fromSector = state.sector;
+
+		// Keep the position within the track, so jumps land at the same angle
+		const uint32_t track = sectorToTrack(fromSector);
+		const uint32_t offset = fromSector - trackToSector(track);
+
+		if (rev && step > track)
+		{
+			toSector = 0;
+		}
+		else
+		{
+			const uint32_t targetTrack = rev ? track - step : track + step;
+			const uint32_t trackStart = trackToSector(targetTrack);
+			toSector = std::min<uint32_t>(trackStart + std::min(offset, sectorsPerTrack(trackStart) - 1), c_sectorMax);
+		}
+
+		state.sector = toSector;
+		state.skipSubq = toSector;
+	});
+	m_i2s.prefetchHint(toSector);
+
+	const uint32_t seekDistance = (toSector > fromSector) ? toSector - fromSector : fromSector - toSector;
+	STATS_INC(seeks);
+	STATS_ADD(seekSectors, seekDistance);
+	STATS_MAX(longestSeek, seekDistance);
+	TRACE_EVENT(Trace::EVENT_SEEK, rev ? Trace::FLAG_REVERSE : 0, std::min<uint32_t>(step, 0xFFFF),
+				fromSector, toSector);
 #ifdef DEBUG_CMD	
-	DEBUG_PRINT("set sector %d\n", m_sector-4500);
+	DEBUG_PRINT("set sector %d\n", toSector-4500);
 #endif
 }
 
 bool __time_critical_func(picostation::DriveMechanics::servo_valid)()
 {
-	return m_sector < c_sectorMax;
+	return getState().sector < (uint32_t)c_sectorMax;
 
 }
 
-void __time_critical_func(picostation::DriveMechanics::moveSled)(picostation::MechCommand &mechCommand){
-    if ((time_us_64() - m_sledTimer) > c_MaxTrackMoveTime)
-    {
-		cur_track_counter++;
-		
-		if (!(cur_track_counter & 255))
-		{
-			mechCommand.setSens(SENS::COUT, !mechCommand.getSens(SENS::COUT));
-		}
-		
-		m_sledTimer = time_us_64();
-    }
+uint32_t __time_critical_func(picostation::DriveMechanics::get_track_count)()
+{
+	if (!isSledStopped())
+	{
+		const uint32_t irqState = save_and_disable_interrupts();
+		const uint32_t tracks = sledTracks();
+		restore_interrupts(irqState);
+		return tracks;
+	}
+	return cur_track_counter;
 }
 
-void __time_critical_func(picostation::DriveMechanics::startSled)()
+void __time_critical_func(picostation::DriveMechanics::startSled)([[maybe_unused]] bool rev)
 {
-	sled_work = true;
 	cur_track_counter = 0;
-	m_sledTimer = time_us_64();
+	m_sledWraps = 0;
+	pwm_set_counter(m_sledSlice, 0);
+	pwm_clear_irq(m_sledSlice);
+	pwm_set_enabled(m_sledSlice, true);
+	update([](State &state) { state.sledWork = true; });
+	TRACE_EVENT(Trace::EVENT_SLED_START, rev ? Trace::FLAG_REVERSE : 0, 0, getSector(), 0);
 }
 
+void __time_critical_func(picostation::DriveMechanics::stopSled)()
+{
+	const uint32_t irqState = save_and_disable_interrupts();
+	pwm_set_enabled(m_sledSlice, false);
+	cur_track_counter = sledTracks();
+	if (pwm_get_irq_status_mask() & (1u << m_sledSlice))
+	{
+		sledWrap();  // the last COUT edge, before its IRQ ran
+	}
+	restore_interrupts(irqState);
+
+	update([](State &state) { state.sledWork = false; });
+	TRACE_EVENT(Trace::EVENT_SLED_STOP, 0, 0, getSector(), cur_track_counter);
+}
@@ -15,14 +15,22 @@
 #include "drive_mechanics.h"
 #include "ff.h"
 #include "global.h"
+#include "hardware/irq.h"
 #include "hardware/pio.h"
+#include "hardware/sync.h"
+#include "iso_index.h"
+#include "loader_stream.h"
 #include "logging.h"
 #include "main.pio.h"
 #include "modchip.h"
 #include "pico/stdlib.h"
 #include "picostation.h"
 #include "pseudo_atomics.h"
+#include "run_profile.h"
+#include "sector_worker.h"
+#include "stats.h"
 #include "subq.h"
+#include "trace.h"
 #include "values.h"
 #include "listingBuilder.h"
 
@@ -32,12 +40,29 @@
 #define DEBUG_PRINT(...) while (0)
 #endif
 
-pseudoatomic<picostation::FileListingStates> needFileCheckAction;
-pseudoatomic<int> listReadyState;
+static constexpr int c_prefetchDepth = 4;  // sectors read after a seek landing
+static constexpr int c_readAheadMin = 2;    // sectors kept in front of the requests while streaming
+static constexpr int c_readAheadMax = CACHED_SECS / 2;
+static constexpr uint32_t c_driveIdleUs = 1000000;  // spindle stopped this long before writing hints
+static constexpr int c_warmupSectors = CACHED_SECS / 2;  // leave room for the boot reads that come first
+static constexpr int c_isoSectorOffset = c_leadIn + c_preGap;  // ISO9660 LBA 0
+
+// Menu command being worked on, taken from g_menuCommands once the previous one has finished
+static picostation::FileListingStates needFileCheckAction;
+static int listReadyState;
+static uint32_t fileArg;
 pseudoatomic<int> g_entryOffset;
 
 picostation::DiscImage::DataLocation s_dataLocation = picostation::DiscImage::DataLocation::RAM;
 
+// Typical SD read time decides whether a read still fits before the DMA runs dry, the recent worst one
+// how far ahead to read so a stall is covered by cached sectors
+static inline void __time_critical_func(updateReadLatency)(const uint32_t us, uint32_t &averageUs, uint32_t &tailUs)
+{
+    averageUs += ((int32_t)us - (int32_t)averageUs) / 8;
+    tailUs = std::max(us, tailUs - tailUs / 64);
+}
+
 static uint16_t *__time_critical_func(generateScramblingLUT)()
 {
     static uint16_t ScramblingLUT[1176] = {0};
@@ -85,6 +110,94 @@ int __time_critical_func(picostation::I2S::initDMA)(const volatile void *read_ad
     return channel;
 }
 
+void __time_critical_func(picostation::I2S::collectSectorJobs)()
+{
+    const uint32_t epoch = m_cacheEpoch.Load();
+    if (epoch != m_cacheEpochSeen)
+    {
+        m_cache.invalidate();
+        m_cacheEpochSeen = epoch;
+        m_cacheGeneration = g_discImage.generation();
+        lastSector = -1;
+    }
+
+    while (SectorJob *job = g_sectorWorker.collect())
+    {
+        if (job->epoch == epoch)
+        {
+            m_cache.assign(job->slot, job->sector);
+        }
+    }
+}
+
+// Neither the slot published for the DMA nor the one it is still reading; the loop runs on while a sector
+// plays, so those differ once the next one is published. A job from before the cache was dropped may
+// still be filling a slot the cache now counts as free.
+uint8_t __time_critical_func(picostation::I2S::allocateSlot)(const uint8_t busySlot)
+{
+    const uint8_t slot = m_cache.allocate(busySlot, m_sendingSlot);
+    while (g_sectorWorker.slotInFlight(slot))
+    {
+        collectSectorJobs();
+    }
+    return slot;
+}
+
+static picostation::I2S *s_i2s;
+
+static void __time_critical_func(dmaIrqHandler)()
+{
+    s_i2s->onDmaComplete();
+}
+
+// The next buffer follows the last one straight away; the PIO FIFO covers the IRQ latency and every
+// word is a whole stereo sample, so the stream stays in step with LRCK without waiting for it
+void __time_critical_func(picostation::I2S::onDmaComplete)()
+{
+    dma_channel_acknowledge_irq1(dmaChannel);
+    if (dma_channel_is_busy(dmaChannel))
+    {
+        return;  // the loop restarted it meanwhile
+    }
+
+    const int currentSector = g_driveMechanics.getSector();
+    if (i2s_state && currentSector >= 4503 && currentSector < c_sectorMax)
+    {
+        sendSlot(m_dmaSlot);
+    }
+}
+
+// Nothing newer published means the head is waiting for a sector, the last one goes out again
+void __time_critical_func(picostation::I2S::sendSlot)(const uint8_t slot)
+{
+    const int dmaSector = m_cache.sector(slot);
+    m_sectorSending = dmaSector;
+    m_sendingSlot = slot;
+    m_lastSectorTime = time_us_64();
+
+    dma_hw->ch[dmaChannel].read_addr = (uint32_t)m_samples[slot];
+
+    // While playing through, each sector has to follow the previous one within a sector period
+    const uint32_t dmaTime = time_us_32();
+    if (m_lastDmaSector >= 0 && dmaSector == m_lastDmaSector + 1 &&
+        (dmaTime - m_lastDmaTime) > (c_sectorPeriodUs / g_targetPlaybackSpeed) + c_sectorDeadlineSlackUs)
+    {
+        STATS_INC(deadlineMisses);
+    }
+    else if (dmaSector == m_lastDmaSector && g_driveMechanics.getSector() == dmaSector + 1 &&
+             g_discImage.isAudioSector(dmaSector - c_leadIn))
+    {
+        // Repeating audio covers the gap, data sectors just hold the head until the next one is sent
+        STATS_INC(concealedSectors);
+    }
+    m_lastDmaSector = dmaSector;
+    m_lastDmaTime = dmaTime;
+
+    dma_channel_start(dmaChannel);
+    __sev();  // core0 moves the head on
+    TRACE_EVENT(Trace::EVENT_SECTOR_DMA, 0, 0, dmaSector, dmaTime - m_dmaPublishTime);
+}
+
 [[noreturn]] void __time_critical_func(picostation::I2S::start)(MechCommand &mechCommand)
 {
     picostation::ModChip modChip;
@@ -106,42 +219,87 @@ int __time_critical_func(picostation::I2S::initDMA)(const volatile void *read_ad
     menu_active = true;
     s_doorPending = false;
     
+    // Strict round robin, so sectors read ahead don't evict each other
+    m_cache.setReplacement(SectorCache<CACHED_SECS>::Replacement::FIFO);
     reinitI2S();
 	
     dmaChannel = initDMA(pioSamples[0], 1176);
+    m_samples = pioSamples;
+    m_dmaSlot = bufferForDMA;
+    m_sendingSlot = bufferForDMA;
+    m_lastDmaSector = -1;
+    m_lastDmaTime = 0;
+
+    // Core1's DMA IRQ feeds the I2S channel from here on, the loop below only produces sectors
+    s_i2s = this;
+    dma_channel_set_irq1_enabled(dmaChannel, true);
+    irq_set_exclusive_handler(DMA_IRQ_1, dmaIrqHandler);
+    irq_set_enabled(DMA_IRQ_1, true);
 
     g_coreReady[1] = true;          // Core 1 is ready
-    while (!g_coreReady[0].Load())  // Wait for Core 0 to be ready
-    {
-        tight_loop_contents();
-    }
 
     modChip.init();
+    g_loaderStream.init();
 
 #if DEBUG_I2S
     uint64_t startTime;
     uint64_t endTime;
 #endif
+    uint32_t requestTime = 0;
+    // Read-ahead window [prefetchNext, prefetchEnd), from a seek landing or the game's run profile.
+    // A window that follows the head is only read up to readAheadDepth sectors in front of it.
+    uint32_t prefetchHint = 0;
+    int prefetchNext = 0;
+    int prefetchEnd = 0;
+    bool prefetchFollowsHead = false;
+    int lastRequested = -1;
+    int prefetchReach = c_readAheadMin;
+    // CD-DA or real-time XA (FMV, streamed music) playing through, detected from the track type and subheader
+    bool realTimeStream = false;
+    uint32_t readLatencyAvgUs = 2000;
+    uint32_t readLatencyTailUs = 4000;
+    // Sectors the BIOS reads first after a mount, cached while the console is still booting
+    int warmup[c_warmupSectors];
+    int warmupCount = 0;
+    int warmupNext = 0;
+    uint32_t warmResetsSeen = 0;
+    uint32_t menuReturnsSeen = 0;
+    uint32_t driveActiveTime = 0;  // last pass the spindle was on
 
+    // Core0 is still holding the console in reset, so the SD card and the first listing are ready by the
+    // time the BIOS or the loader asks for a sector
     char autoBootFile[128] = {0};
     uint8_t autoBootFileCount = picostation::DirectoryListing::checkAutoBoot(autoBootFile);
+    stats_boot_phase(BOOT_PHASE_AUTOBOOT);
     if(autoBootFileCount>0){
         //printf("AUTO BOOT\n");
 		s_dataLocation = picostation::DiscImage::DataLocation::SDCard;
 		loadedImageIndex = 0;
 		g_discImage.load(autoBootFile);
+		g_runProfile.open(autoBootFile);
+		g_isoIndex.build();
+		warmupCount = g_isoIndex.warmupSectors(warmup, c_warmupSectors);
+		warmupNext = 0;
 		img_count = autoBootFileCount;
 		reinitI2S();
 		g_driveMechanics.resetDrive();
 		g_discImage.set_skip_bootsector(false);
 		mechCommand.resetBootSectorPattern();
+		stats_boot_phase(BOOT_PHASE_IMAGE);
     }else{
         menu_active = true;
         g_discImage.makeDummyCue();
+        stats_boot_phase(BOOT_PHASE_IMAGE);
         // this need to be moved to diskimage
         picostation::DirectoryListing::init();
         picostation::DirectoryListing::getDirectoryEntries(0);
     }
+    stats_boot_phase(BOOT_PHASE_LISTING);
+
+    while (!g_coreReady[0].Load())  // Wait for Core 0 to be ready
+    {
+        tight_loop_contents();
+    }
     
     while (true)
     {
@@ -149,10 +307,63 @@ int __time_critical_func(picostation::I2S::initDMA)(const volatile void *read_ad
         currentSector = g_driveMechanics.getSector();
         
         modChip.sendLicenseString(currentSector, mechCommand);
+
+        collectSectorJobs();
+
+        // A short reset boots the same image again, and its first reads are the ones warmed up at mount
+        const uint32_t warmResets = m_warmResets.Load();
+        if (warmResets != warmResetsSeen)
+        {
+            warmResetsSeen = warmResets;
+            warmupNext = 0;
+            lastSector = -1;
+            // Anything set up since the cache was filled makes it a cold one
+            if (menu_active || m_cacheGeneration != g_discImage.generation())
+            {
+                requestReinitI2S();
+                collectSectorJobs();
+            }
+        }
+
+        const uint32_t menuReturns = m_menuReturns.Load();
+        if (menuReturns != menuReturnsSeen)
+        {
+            menuReturnsSeen = menuReturns;
+            if (s_dataLocation != picostation::DiscImage::DataLocation::RAM)
+            {
+                g_discImage.unload();
+                g_discImage.makeDummyCue();
+                g_discImage.set_skip_edc(false);
+                menu_active = true;
+                reinitI2S();  // nothing of the old image stays cached, whichever request core1 saw first
+            }
+            picostation::DirectoryListing::gotoRoot();
+            s_dataLocation = picostation::DiscImage::DataLocation::RAM;
+        }
 		
-		if (menu_active && needFileCheckAction.Load() != picostation::FileListingStates::IDLE)
+		picostation::MenuCommand menuCommand;
+		if (!menu_active)
+		{
+			// A mounted game has no menu to answer
+			while (g_menuCommands.pop(menuCommand))
+			{
+			}
+		}
+		else if ((needFileCheckAction == picostation::FileListingStates::IDLE ||
+				  (needFileCheckAction == picostation::FileListingStates::PROCESS_FILES && listReadyState)) &&
+				 g_menuCommands.pop(menuCommand))
+		{
+			needFileCheckAction = menuCommand.action;
+			fileArg = menuCommand.arg;
+			if (menuCommand.action != picostation::FileListingStates::IDLE)
+			{
+				listReadyState = 0;
+			}
+		}
+
+		if (menu_active && needFileCheckAction != picostation::FileListingStates::IDLE)
 		{
-			switch (needFileCheckAction.Load())
+			switch (needFileCheckAction)
 			{
 				case picostation::FileListingStates::GOTO_ROOT:
 				{
@@ -174,8 +385,8 @@ int __time_critical_func(picostation::I2S::initDMA)(const volatile void *read_ad
 				
 				case picostation::FileListingStates::GOTO_DIRECTORY:
 				{
-					//printf("Processing GOTO_DIRECTORY %i\n", g_fileArg.Load());
-					picostation::DirectoryListing::gotoDirectory(g_fileArg.Load());
+					//printf("Processing GOTO_DIRECTORY %i\n", fileArg);
+					picostation::DirectoryListing::gotoDirectory(fileArg);
 					g_entryOffset = 0;
 					needFileCheckAction = picostation::FileListingStates::PROCESS_FILES;
 					break;
@@ -184,7 +395,7 @@ int __time_critical_func(picostation::I2S::initDMA)(const volatile void *read_ad
 				case picostation::FileListingStates::GET_NEXT_CONTENTS:
 				{
 					//printf("Processing GET_NEXT_CONTENTS\n");
-					g_entryOffset = g_fileArg.Load();
+					g_entryOffset = fileArg;
 					needFileCheckAction = picostation::FileListingStates::PROCESS_FILES;
 					break;
 				}
@@ -194,10 +405,15 @@ int __time_critical_func(picostation::I2S::initDMA)(const volatile void *read_ad
 					//printf("Processing MOUNT_FILE\n");
 					s_dataLocation = picostation::DiscImage::DataLocation::SDCard;
 					char filePath[c_maxFilePathLength + 1];
-					loadedImageIndex = g_fileArg.Load();
+					loadedImageIndex = fileArg;
 					picostation::DirectoryListing::getPath(loadedImageIndex, filePath);
 					//printf("image cue name:%s\n", filePath);
 					g_discImage.load(filePath);
+					g_runProfile.open(filePath);
+					g_isoIndex.build();
+					warmupCount = g_isoIndex.warmupSectors(warmup, c_warmupSectors);
+					warmupNext = 0;
+					stats_reset();
 					needFileCheckAction = picostation::FileListingStates::IDLE;
 					img_count = DirectoryListing::getDirectoryEntriesCount();
 					menu_active = false;
@@ -215,7 +431,7 @@ int __time_critical_func(picostation::I2S::initDMA)(const volatile void *read_ad
 				
 				case picostation::FileListingStates::PROCESS_FILES:
 				{
-					if (!listReadyState.Load())
+					if (!listReadyState)
 					{
 						picostation::DirectoryListing::getDirectoryEntries(g_entryOffset.Load());
 						listReadyState = 1;
@@ -225,9 +441,9 @@ int __time_critical_func(picostation::I2S::initDMA)(const volatile void *read_ad
 				
 				case picostation::FileListingStates::GET_COVER:
 				{
-					if (!listReadyState.Load())
+					if (!listReadyState)
 					{
-						picostation::DirectoryListing::openCover(g_fileArg.Load());
+						picostation::DirectoryListing::openCover(fileArg);
 						needFileCheckAction = picostation::FileListingStates::PROCESS_FILES;
 						listReadyState = 1;
 					}
@@ -236,9 +452,9 @@ int __time_critical_func(picostation::I2S::initDMA)(const volatile void *read_ad
 
                 case picostation::FileListingStates::GET_COVER_ART:
 				{
-					if (!listReadyState.Load())
+					if (!listReadyState)
 					{
-						picostation::DirectoryListing::openCoverArt(g_fileArg.Load());
+						picostation::DirectoryListing::openCoverArt(fileArg);
 						needFileCheckAction = picostation::FileListingStates::PROCESS_FILES;
 						listReadyState = 1;
 					}
@@ -247,7 +463,7 @@ int __time_critical_func(picostation::I2S::initDMA)(const volatile void *read_ad
 				
 				case picostation::FileListingStates::GET_CFG:
 				{
-					if (!listReadyState.Load())
+					if (!listReadyState)
 					{
 						picostation::DirectoryListing::openCfg();
 						needFileCheckAction = picostation::FileListingStates::PROCESS_FILES;
@@ -256,6 +472,17 @@ int __time_critical_func(picostation::I2S::initDMA)(const volatile void *read_ad
 					break;
 				}
 				
+				case picostation::FileListingStates::GET_STATS:
+				{
+					if (!listReadyState)
+					{
+						stats_snapshot();
+						needFileCheckAction = picostation::FileListingStates::PROCESS_FILES;
+						listReadyState = 1;
+					}
+					break;
+				}
+				
 				default:
 					break;
 			}
@@ -272,6 +499,10 @@ int __time_critical_func(picostation::I2S::initDMA)(const volatile void *read_ad
 			picostation::DirectoryListing::getPath(loadedImageIndex, filePath);
 			g_discImage.unload();
 			g_discImage.load(filePath);
+			g_runProfile.open(filePath);
+			g_isoIndex.build();
+			warmupCount = g_isoIndex.warmupSectors(warmup, c_warmupSectors);
+			warmupNext = 0;
 			
 			reinitI2S();
 			g_driveMechanics.resetDrive();
@@ -280,32 +511,96 @@ int __time_critical_func(picostation::I2S::initDMA)(const volatile void *read_ad
         // Data sent via DMA, load the next sector
         if (currentSector != lastSector && currentSector >= 4503 && currentSector < c_sectorMax)
         {
+			requestTime = time_us_32();
 			if (!menu_active)
 			{
-				for (int i = 0; i < CACHED_SECS; i++)
+				const bool sequential = currentSector == lastRequested + 1;
+				if (!sequential)
+				{
+					realTimeStream = false;
+				}
+				else if (realTimeStream)
+				{
+					STATS_INC(streamSectors);
+				}
+
+				const uint32_t sectorPeriodUs = c_sectorPeriodUs / g_targetPlaybackSpeed;
+				const int readAheadDepth = realTimeStream ? c_readAheadMax :
+					std::clamp<int>(c_readAheadMin + readLatencyTailUs / sectorPeriodUs, c_readAheadMin, c_readAheadMax);
+
+				// The head went somewhere the read-ahead window didn't predict
+				if (!sequential &&
+					(currentSector < prefetchNext - c_landingSlack || currentSector >= prefetchEnd))
+				{
+					prefetchNext = prefetchEnd;
+				}
+				lastRequested = currentSector;
+
+				const RunProfile::Prediction prediction = g_runProfile.record(currentSector);
+				if (realTimeStream)
 				{
-					if (loadedSector[i] == currentSector)
+					// Deep ring in front of the stream, and nothing else gets the card
+					prefetchNext = currentSector + 1;
+					prefetchEnd = prefetchNext + readAheadDepth;
+					prefetchFollowsHead = true;
+				}
+				else if (prediction.end > prediction.start)
+				{
+					prefetchNext = prediction.start;
+					prefetchEnd = prediction.end;
+					prefetchFollowsHead = prediction.followsHead;
+				}
+				else if (prefetchNext >= prefetchEnd)
+				{
+					// Reading a file, follow it to its end
+					const IsoIndex::Extent *extent = g_isoIndex.find(currentSector - c_isoSectorOffset);
+					if (extent && !extent->directory)
 					{
-						// already in cache
-						bufferForDMA = i;
-						lastSector = currentSector;
+						prefetchNext = currentSector + 1;
+						prefetchEnd = extent->lba + extent->sectors + c_isoSectorOffset;
+						prefetchFollowsHead = true;
+					}
+					else if (sequential)
+					{
+						// Audio and anything else played through
+						prefetchNext = currentSector + 1;
+						prefetchEnd = prefetchNext + readAheadDepth;
+						prefetchFollowsHead = true;
+					}
+				}
+				prefetchReach = readAheadDepth;
+
+				// Read ahead already, core0 is still finishing it
+				while (g_sectorWorker.inFlight(currentSector))
+				{
+					collectSectorJobs();
+				}
+
+				const int cachedSlot = m_cache.find(currentSector);
+				if (cachedSlot >= 0)
+				{
+					// already in cache
+					bufferForDMA = cachedSlot;
+					lastSector = currentSector;
 #if DEBUG_I2S0
-						DEBUG_PRINT("sector %d in cache\n", currentSector);
+					DEBUG_PRINT("sector %d in cache\n", currentSector);
 #endif
-						goto continue_transfer;
-					}
+					STATS_INC(cacheHits);
+					TRACE_EVENT(Trace::EVENT_SECTOR_REQUEST, Trace::FLAG_CACHE_HIT, 0, currentSector, 0);
+					goto continue_transfer;
 				}
 			}
 			
-			while (bufferForSDRead == bufferForDMA)
-			{
-				++bufferForSDRead &= (CACHED_SECS-1);
-			}
+			bufferForSDRead = allocateSlot(bufferForDMA);
 			
-			if (menu_active && needFileCheckAction.Load() == picostation::FileListingStates::PROCESS_FILES && listReadyState.Load())
+			// A command latched or queued behind this one makes what is ready stale, the menu reads again once it
+			// has run. The counts first: core0 pushes before it counts, so a match means the queue holds the rest.
+			if (menu_active && needFileCheckAction == picostation::FileListingStates::PROCESS_FILES && listReadyState &&
+				g_menuCommandsQueued.Load() == g_menuCommandsLatched.Load() && g_menuCommands.empty())
 			{
 				if (currentSector == 4750)
 				{
+					stats_boot_phase(BOOT_PHASE_MENU_READ);
 					g_discImage.buildSector(currentSector - c_leadIn, pioSamples[bufferForSDRead], picostation::DirectoryListing::getFileListingData(), cdScramblingLUT);
 					needFileCheckAction = picostation::FileListingStates::IDLE;
 				}
@@ -317,6 +612,10 @@ int __time_critical_func(picostation::I2S::initDMA)(const volatile void *read_ad
 				{
 					g_discImage.buildSector(currentSector - c_leadIn, pioSamples[bufferForSDRead], picostation::DirectoryListing::readCfg(), cdScramblingLUT);
 				}
+				else if (currentSector == 4810)
+				{
+					g_discImage.buildSector(currentSector - c_leadIn, pioSamples[bufferForSDRead], stats_read_sector(), cdScramblingLUT);
+				}
 				else
 				{
 					goto not_menu_request;
@@ -330,6 +629,13 @@ not_menu_request:
 #endif
 				// Load the next sector
 				g_discImage.readSector(pioSamples[bufferForSDRead], currentSector - c_leadIn, s_dataLocation, cdScramblingLUT);
+				STATS_INC(cacheMisses);
+				stats_read_latency(time_us_32() - requestTime);
+				updateReadLatency(time_us_32() - requestTime, readLatencyAvgUs, readLatencyTailUs);
+				if (!menu_active)
+				{
+					realTimeStream = g_discImage.lastReadRealTime();
+				}
 #if DEBUG_I2S
 				endTime = time_us_64()-startTime;
 				
@@ -340,41 +646,153 @@ not_menu_request:
 #endif
 			}
 			
-			loadedSector[bufferForSDRead] = currentSector;
+			TRACE_EVENT(Trace::EVENT_SECTOR_REQUEST, 0, 0, currentSector, time_us_32() - requestTime);
+
+			m_cache.assign(bufferForSDRead, currentSector);
 			bufferForDMA = bufferForSDRead;
 			lastSector = currentSector;
 		}
 
 continue_transfer:
 
-        // Start the next transfer if the DMA channel is not busy
-        if (!dma_channel_is_busy(dmaChannel) && i2s_state)
+        // The DMA IRQ sends it once the sector before it is out
+        m_dmaPublishTime = requestTime;
+        m_dmaSlot = bufferForDMA;
+
+        // Only (re)starting the stream is left to the loop, in step with LRCK
+        if (i2s_state && !dma_channel_is_busy(dmaChannel))
         {
-			if (currentSector >= 4503 && currentSector < c_sectorMax)
-			{
-				m_sectorSending = loadedSector[bufferForDMA];
-				m_lastSectorTime = time_us_64();
+            const uint32_t irqState = save_and_disable_interrupts();
+            if (!dma_channel_is_busy(dmaChannel))
+            {
+                if (currentSector >= 4503 && currentSector < c_sectorMax)
+                {
+                    // Sync with the I2S clock
+                    while (gpio_get(Pin::LRCK) == 1)
+                    {
+                        tight_loop_contents();
+                    }
 
-				dma_hw->ch[dmaChannel].read_addr = (uint32_t)pioSamples[bufferForDMA];
+                    while (gpio_get(Pin::LRCK) == 0)
+                    {
+                        tight_loop_contents();
+                    }
 
-				// Sync with the I2S clock
-				while (gpio_get(Pin::LRCK) == 1)
-				{
-					tight_loop_contents();
-				}
-				
-				while (gpio_get(Pin::LRCK) == 0)
-				{
-					tight_loop_contents();
-				}
+                    sendSlot(bufferForDMA);
+                }
+                else if (picostation::g_subqDelay == false)
+                {
+                    m_lastDmaSector = -1;
+                    m_sectorSending = currentSector;
+                    m_lastSectorTime = time_us_64();
+                    __sev();
+                }
+            }
+            restore_interrupts(irqState);
+        }
 
-				dma_channel_start(dmaChannel);
-			}
-			else if(picostation::g_subqDelay == false)
-			{
-				m_sectorSending = currentSector;
-				m_lastSectorTime = time_us_64();
-			}
+        // A seek landing outside the current window starts a new one
+        const uint32_t hint = m_prefetchHint.Load();
+        if (hint != prefetchHint)
+        {
+            prefetchHint = hint;
+            const int landing = hint & 0xFFFFFF;
+            if (landing < prefetchNext - c_landingSlack || landing >= prefetchEnd)
+            {
+                prefetchNext = landing + 1;
+                prefetchEnd = prefetchNext + c_prefetchDepth;
+                prefetchFollowsHead = true;
+            }
+        }
+
+        // Read ahead one sector per pass, so a new request never waits for more than one read. While
+        // streaming only if a typical read still ends before the sector playing does.
+        if (!menu_active && currentSector == lastSector && prefetchNext < prefetchEnd &&
+            (!i2s_state || (dma_channel_is_busy(dmaChannel) &&
+                            (time_us_32() - m_lastDmaTime) + readLatencyAvgUs < c_sectorPeriodUs / g_targetPlaybackSpeed)))
+        {
+            if (prefetchFollowsHead && prefetchNext <= currentSector)
+            {
+                prefetchNext = currentSector + 1;
+            }
+
+            while (prefetchNext < prefetchEnd && m_cache.find(prefetchNext) >= 0)
+            {
+                prefetchNext++;
+            }
+
+            const bool inReach = !prefetchFollowsHead || prefetchNext <= currentSector + prefetchReach;
+            if (prefetchNext < prefetchEnd && prefetchNext < c_sectorMax && inReach)
+            {
+                SectorJob *job = g_sectorWorker.acquire();
+                if (job)
+                {
+                    const uint8_t slot = allocateSlot(bufferForDMA);
+                    const uint32_t readStart = time_us_32();
+
+                    // Sectors that need EDC go to core0 and are mapped once finished, the rest are ready now
+                    m_cache.assign(slot, SectorCache<CACHED_SECS>::c_emptySlot);
+                    if (s_dataLocation == picostation::DiscImage::DataLocation::SDCard &&
+                        g_discImage.readSectorRaw(job->raw, prefetchNext - c_leadIn))
+                    {
+                        job->samples = pioSamples[slot];
+                        job->scrambling = cdScramblingLUT;
+                        job->sector = prefetchNext;
+                        job->epoch = m_cacheEpochSeen;
+                        job->slot = slot;
+                        g_sectorWorker.submit(job);
+                    }
+                    else
+                    {
+                        g_sectorWorker.release(job);
+                        g_discImage.readSector(pioSamples[slot], prefetchNext - c_leadIn, s_dataLocation, cdScramblingLUT);
+                        m_cache.assign(slot, prefetchNext);
+                    }
+
+                    updateReadLatency(time_us_32() - readStart, readLatencyAvgUs, readLatencyTailUs);
+                    if (prefetchFollowsHead)
+                    {
+                        realTimeStream = g_discImage.lastReadRealTime();
+                    }
+                    STATS_INC(prefetchReads);
+                    prefetchNext++;
+                }
+            }
+        }
+        else if (!menu_active && !i2s_state && warmupNext < warmupCount &&
+                 (currentSector == lastSector || currentSector < 4503 || currentSector >= c_sectorMax))
+        {
+            // Still booting, one sector per pass as well
+            const int sector = warmup[warmupNext++] + c_isoSectorOffset;
+            if (m_cache.find(sector) < 0 && sector < c_sectorMax)
+            {
+                const uint8_t slot = allocateSlot(bufferForDMA);
+                g_discImage.readSector(pioSamples[slot], sector - c_leadIn, s_dataLocation, cdScramblingLUT);
+                m_cache.assign(slot, sector);
+                STATS_INC(warmupReads);
+            }
+        }
+
+        // Nothing is streaming while the drive is stopped or seeking. A seek's landing sector is due any
+        // moment though, so SD writes wait until the console has stopped the spindle for a while.
+        if (i2s_state || mechCommand.getSens(SENS::GFS))
+        {
+            driveActiveTime = time_us_32();
+        }
+        const bool driveIdle = (time_us_32() - driveActiveTime) > c_driveIdleUs;
+
+        if (!i2s_state)
+        {
+            TRACE_FLUSH(driveIdle);
+
+            if (menu_active)
+            {
+                g_runProfile.close();
+            }
+            else if (driveIdle)
+            {
+                g_runProfile.flushIfIdle();
+            }
         }
     }
     __builtin_unreachable();
@@ -0,0 +1,241 @@
+#include "iso_index.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "disc_image.h"
+#include "logging.h"
+#include "pico/platform.h"
+
+#if DEBUG_FILEIO
+#define DEBUG_PRINT(...) printf(__VA_ARGS__)
+#else
+#define DEBUG_PRINT(...) while (0)
+#endif
+
+static constexpr int c_pvdLba = 16;
+static constexpr size_t c_userDataSize = 2048;
+static constexpr size_t c_recordMinLength = 34;
+
+static uint8_t s_sector[c_userDataSize];
+
+picostation::IsoIndex picostation::g_isoIndex;
+
+static inline uint32_t readLE32(const uint8_t *p) { return p[0] | (p[1] << 8) | (p[2] << 16) | (p[3] << 24); }
+
+static inline uint32_t sectorsFor(const uint32_t bytes) { return (bytes + c_userDataSize - 1) / c_userDataSize; }
+
+// Next directory record in s_sector, records never cross a sector and zero padding ends it
+static const uint8_t *nextRecord(size_t &offset)
+{
+    if (offset + c_recordMinLength > c_userDataSize)
+    {
+        return nullptr;
+    }
+
+    const uint8_t *record = &s_sector[offset];
+    const size_t length = record[0];
+    if (length < c_recordMinLength || offset + length > c_userDataSize || 33 + record[32] > length)
+    {
+        return nullptr;
+    }
+
+    offset += length;
+    return record;
+}
+
+static picostation::IsoIndex::Extent recordExtent(const uint8_t *record)
+{
+    picostation::IsoIndex::Extent extent;
+    extent.lba = readLE32(&record[2]);
+    extent.directory = (record[25] & 0x02) ? 1 : 0;
+    extent.sectors = sectorsFor(readLE32(&record[10]));
+    return extent;
+}
+
+void picostation::IsoIndex::build()
+{
+    clear();
+
+    if (!g_discImage.readUserData(s_sector, c_pvdLba) || s_sector[0] != 1 || memcmp(&s_sector[1], "CD001", 5) != 0)
+    {
+        DEBUG_PRINT("iso: no ISO9660 volume\n");
+        return;
+    }
+
+    const Extent root = recordExtent(&s_sector[156]);
+    m_extents[m_count++] = root;
+
+    // Breadth first, directories found are appended and walked in turn
+    for (size_t i = 0; i < m_count; i++)
+    {
+        if (m_extents[i].directory)
+        {
+            addDirectory(m_extents[i]);
+        }
+    }
+    std::sort(m_extents, m_extents + m_count,
+              [](const Extent &a, const Extent &b) { return a.lba < b.lba; });
+
+    m_warm[m_warmCount++] = {c_pvdLba, 0, 1};
+    m_warm[m_warmCount++] = root;
+
+    Extent systemCnf;
+    if (findEntry(root, "SYSTEM.CNF", 10, systemCnf))
+    {
+        m_warm[m_warmCount++] = systemCnf;
+
+        char path[64];
+        const size_t length = bootPath(systemCnf, path, sizeof(path));
+
+        // Walk the path one directory at a time
+        Extent entry = root;
+        size_t start = 0;
+        bool found = length > 0;
+        while (found && start < length)
+        {
+            const char *separator = (const char *)memchr(&path[start], '\\', length - start);
+            const size_t end = separator ? separator - path : length;
+            found = findEntry(entry, &path[start], end - start, entry);
+            start = end + 1;
+        }
+
+        if (found && !entry.directory)
+        {
+            m_warm[m_warmCount++] = entry;
+        }
+    }
+
+    DEBUG_PRINT("iso: %u extents, %u warmup extents\n", m_count, m_warmCount);
+}
+
+const picostation::IsoIndex::Extent *__time_critical_func(picostation::IsoIndex::find)(const int lba) const
+{
+    if (lba < 0)
+    {
+        return nullptr;
+    }
+
+    const Extent *extent = std::upper_bound(m_extents, m_extents + m_count, (uint32_t)lba,
+                                            [](const uint32_t value, const Extent &e) { return value < e.lba; });
+    if (extent == m_extents)
+    {
+        return nullptr;
+    }
+
+    extent--;
+    return ((uint32_t)lba < extent->lba + extent->sectors) ? extent : nullptr;
+}
+
+size_t picostation::IsoIndex::warmupSectors(int *lbas, const size_t max) const
+{
+    size_t count = 0;
+    for (size_t i = 0; i < m_warmCount && count < max; i++)
+    {
+        for (uint32_t j = 0; j < m_warm[i].sectors && count < max; j++)
+        {
+            lbas[count++] = m_warm[i].lba + j;
+        }
+    }
+    return count;
+}
+
+bool picostation::IsoIndex::findEntry(const Extent &directory, const char *name, const size_t nameLength, Extent &entry)
+{
+    const uint32_t sectors = std::min<uint32_t>(directory.sectors, c_maxDirectorySectors);
+    for (uint32_t s = 0; s < sectors; s++)
+    {
+        if (!g_discImage.readUserData(s_sector, directory.lba + s))
+        {
+            return false;
+        }
+
+        size_t offset = 0;
+        while (const uint8_t *record = nextRecord(offset))
+        {
+            // Names carry a ";1" version suffix
+            const char *recordName = (const char *)&record[33];
+            const char *version = (const char *)memchr(recordName, ';', record[32]);
+            const size_t recordLength = version ? version - recordName : record[32];
+
+            if (recordLength == nameLength && strncasecmp(recordName, name, nameLength) == 0)
+            {
+                entry = recordExtent(record);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void picostation::IsoIndex::addDirectory(const Extent &directory)
+{
+    const uint32_t sectors = std::min<uint32_t>(directory.sectors, c_maxDirectorySectors);
+    for (uint32_t s = 0; s < sectors && m_count < c_maxExtents; s++)
+    {
+        if (!g_discImage.readUserData(s_sector, directory.lba + s))
+        {
+            return;
+        }
+
+        size_t offset = 0;
+        while (const uint8_t *record = nextRecord(offset))
+        {
+            // Skip "." and ".."
+            if (record[32] == 1 && record[33] <= 1)
+            {
+                continue;
+            }
+
+            if (m_count == c_maxExtents)
+            {
+                DEBUG_PRINT("iso: extent table full\n");
+                return;
+            }
+            m_extents[m_count++] = recordExtent(record);
+        }
+    }
+}
+
+// BOOT = cdrom:\DIR\FILE.EXE;1 -> DIR\FILE.EXE
+size_t picostation::IsoIndex::bootPath(const Extent &systemCnf, char *path, const size_t max)
+{
+    if (!g_discImage.readUserData(s_sector, systemCnf.lba))
+    {
+        return 0;
+    }
+
+    const size_t size = c_userDataSize;
+    for (size_t i = 0; i + 4 < size; i++)
+    {
+        if (strncasecmp((const char *)&s_sector[i], "BOOT", 4) != 0 || (i > 0 && s_sector[i - 1] != '\n'))
+        {
+            continue;
+        }
+
+        i += 4;
+        while (i < size && (s_sector[i] == ' ' || s_sector[i] == '\t' || s_sector[i] == '='))
+        {
+            i++;
+        }
+        if (i + 6 <= size && strncasecmp((const char *)&s_sector[i], "cdrom:", 6) == 0)
+        {
+            i += 6;
+        }
+        while (i < size && s_sector[i] == '\\')
+        {
+            i++;
+        }
+
+        size_t length = 0;
+        while (i < size && length < max && s_sector[i] != ';' && !isspace(s_sector[i]) && s_sector[i] != 0)
+        {
+            path[length++] = s_sector[i++];
+        }
+        return (length < max) ? length : 0;
+    }
+    return 0;
+}
@@ -0,0 +1,256 @@
+#include "loader_stream.h"
+
+#include <string.h>
+
+#include "ff.h"
+#include "hardware/dma.h"
+#include "hardware/structs/xip_ctrl.h"
+#include "hardware/timer.h"
+#include "lz4_block.h"
+#include "pico/platform.h"
+#include "stats.h"
+#include "values.h"
+
+extern const uint8_t  loaderImage[];
+extern const uint32_t loaderImageSize;
+
+static_assert(picostation::LoaderStream::c_sectorBytes == c_cdSamplesBytes);
+#if LOADER_BENCHMARK && !LOADER_COMPRESSED
+#error "LOADER_BENCHMARK needs LOADER_COMPRESSED"
+#endif
+
+picostation::LoaderStream picostation::g_loaderStream;
+
+void picostation::LoaderStream::init()
+{
+#if LOADER_COMPRESSED
+    const PackedHeader *header = (const PackedHeader *)loaderImage;
+    if (loaderImageSize < sizeof(PackedHeader) || header->magic != PackedHeader::c_magic)
+    {
+        return;  // no loader, readSectorRAM builds empty sectors
+    }
+    m_sectorCount = header->sectorCount;
+    m_offsets = (const uint32_t *)(header + 1);
+#else
+    m_sectorCount = loaderImageSize / c_sectorBytes;
+#endif
+
+    // The stream FIFO only reads flash through XIP
+    const uintptr_t address = (uintptr_t)loaderImage;
+    if (address < XIP_BASE || address >= XIP_NOCACHE_NOALLOC_BASE || (address & 3))
+    {
+        return;
+    }
+
+    m_channel = dma_claim_unused_channel(true);
+#if LOADER_BENCHMARK
+    benchmark();
+#endif
+}
+
+const uint8_t *__time_critical_func(picostation::LoaderStream::flashBlock)(const uint32_t index, uint32_t &size) const
+{
+#if LOADER_COMPRESSED
+    size = m_offsets[index + 1] - m_offsets[index];
+    return &loaderImage[m_offsets[index]];
+#else
+    size = c_sectorBytes;
+    return &loaderImage[index * c_sectorBytes];
+#endif
+}
+
+// The raw sector from a block, decoded when it is compressed
+const uint8_t *__time_critical_func(picostation::LoaderStream::sectorData)(const uint8_t *block, const uint32_t size)
+{
+#if LOADER_COMPRESSED
+    if (size != c_sectorBytes)
+    {
+        if (!lz4_decode_block(block, size, m_decoded, c_sectorBytes))
+        {
+            memset(m_decoded, 0, c_sectorBytes);  // loader_pack checked every block, only a bad flash gets here
+        }
+        return m_decoded;
+    }
+#endif
+    return block;
+}
+
+// Streams a sector's block into a stage slot other than keepSlot, once the previous stream is done
+void __time_critical_func(picostation::LoaderStream::stage)(const uint32_t index, const size_t keepSlot)
+{
+    finishStream();
+
+    const size_t slot = (keepSlot + 1) % c_stageSlots;
+    uint32_t size;
+    const uint8_t *block = flashBlock(index, size);
+    const uint32_t words = (size + 3) / sizeof(uint32_t);
+    m_stage[slot].index = index;
+    m_stage[slot].size = size;
+
+    // Leftovers of an earlier stream would come out first
+    while (!(xip_ctrl_hw->stat & XIP_STAT_FIFO_EMPTY_BITS))
+    {
+        (void)xip_ctrl_hw->stream_fifo;
+    }
+    xip_ctrl_hw->stream_addr = (uint32_t)(uintptr_t)block;
+    xip_ctrl_hw->stream_ctr = words;
+
+    dma_channel_config config = dma_channel_get_default_config(m_channel);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_32);
+    channel_config_set_read_increment(&config, false);
+    channel_config_set_write_increment(&config, true);
+    channel_config_set_dreq(&config, DREQ_XIP_STREAM);
+    dma_channel_configure(m_channel, &config, m_stage[slot].data, (const void *)XIP_AUX_BASE, words, true);
+    m_streaming = slot;
+}
+
+void __time_critical_func(picostation::LoaderStream::finishStream)()
+{
+    if (m_streaming >= 0)
+    {
+        dma_channel_wait_for_finish_blocking(m_channel);
+        m_streaming = -1;
+    }
+}
+
+// Least read pinned sector makes room once another one has been read more often
+void __time_critical_func(picostation::LoaderStream::pin)(const uint32_t index, const uint8_t *data)
+{
+    if (index >= c_maxSectors)
+    {
+        return;
+    }
+    if (m_reads[index] < UINT8_MAX)
+    {
+        m_reads[index]++;
+    }
+
+    size_t victim = 0;
+    uint8_t victimReads = UINT8_MAX;
+    for (size_t i = 0; i < c_pinnedSlots; i++)
+    {
+        if (m_pinned[i].index == c_noSector)
+        {
+            victim = i;
+            victimReads = 0;
+            break;
+        }
+        if (m_reads[m_pinned[i].index] < victimReads)
+        {
+            victim = i;
+            victimReads = m_reads[m_pinned[i].index];
+        }
+    }
+
+    // Twice before it is worth a slot, so a single pass through the loader doesn't churn them
+    if (m_reads[index] >= 2 && m_reads[index] > victimReads)
+    {
+        memcpy(m_pinned[victim].data, data, c_sectorBytes);
+        m_pinned[victim].index = index;
+        m_pinned[victim].size = c_sectorBytes;
+    }
+}
+
+#if LOADER_BENCHMARK
+// Decoding a compressed sector has to beat reading the raw one through XIP, or compression costs read time.
+// Both are timed from a flushed XIP cache, as a loader sector read after a jump would be. Holds up the
+// power-on by flushing the cache twice per sector, so only in a LOADER_BENCHMARK build.
+void picostation::LoaderStream::benchmark()
+{
+    const uint32_t imageSize = m_offsets[m_sectorCount];
+    for (uint32_t i = 0; i < m_sectorCount; i++)
+    {
+        uint32_t size;
+        const uint8_t *block = flashBlock(i, size);
+
+        xip_ctrl_hw->flush = 1;
+        (void)xip_ctrl_hw->flush;
+        uint32_t start = time_us_32();
+        sectorData(block, size);
+        STATS_ADD(loaderBenchDecodeUs, time_us_32() - start);
+
+        // Any flash reads the same, the raw loader isn't embedded
+        const uint32_t from = (m_offsets[i] + c_sectorBytes <= imageSize) ? m_offsets[i] : 0;
+        xip_ctrl_hw->flush = 1;
+        (void)xip_ctrl_hw->flush;
+        start = time_us_32();
+        memcpy(m_decoded, &loaderImage[from], c_sectorBytes);
+        STATS_ADD(loaderBenchXipUs, time_us_32() - start);
+    }
+}
+#endif
+
+void __time_critical_func(picostation::LoaderStream::read)(uint32_t *buffer, const uint32_t index, const uint16_t *scrambling)
+{
+    uint32_t size;
+    const uint8_t *data = nullptr;
+
+    if (m_channel < 0)
+    {
+        const uint8_t *block = flashBlock(index, size);
+        scramble_data(buffer, (uint16_t *)sectorData(block, size), scrambling, c_cdScrambleLength);
+        return;
+    }
+
+    for (const Slot &slot : m_pinned)
+    {
+        if (slot.index == index)
+        {
+            scramble_data(buffer, (uint16_t *)slot.data, scrambling, c_cdScrambleLength);
+            STATS_INC(loaderPinnedReads);
+            return;
+        }
+    }
+
+    size_t servedSlot = 0;
+    for (size_t i = 0; i < c_stageSlots; i++)
+    {
+        if (m_stage[i].index == index)
+        {
+            if ((int)i == m_streaming)
+            {
+                finishStream();
+            }
+            data = sectorData(m_stage[i].data, m_stage[i].size);
+            servedSlot = i;
+            STATS_INC(loaderStagedReads);
+            break;
+        }
+    }
+
+    if (!data)
+    {
+        // Not streamed ahead, a seek into the loader; the XIP cache is all there is
+        const uint32_t hits = xip_ctrl_hw->ctr_hit;
+        const uint32_t accesses = xip_ctrl_hw->ctr_acc;
+        const uint8_t *block = flashBlock(index, size);
+        data = sectorData(block, size);
+        scramble_data(buffer, (uint16_t *)data, scrambling, c_cdScrambleLength);
+        STATS_ADD(loaderXipHits, xip_ctrl_hw->ctr_hit - hits);
+        STATS_ADD(loaderXipAccesses, xip_ctrl_hw->ctr_acc - accesses);
+        STATS_INC(loaderFlashReads);
+        servedSlot = (m_streaming >= 0) ? m_streaming : 0;  // keep the stream running, it is the other slot
+    }
+    else
+    {
+        scramble_data(buffer, (uint16_t *)data, scrambling, c_cdScrambleLength);
+    }
+
+    pin(index, data);
+
+    // The console reads the loader front to back, the next sector streams in while this one is sent
+    const uint32_t next = index + 1;
+    bool ready = next >= m_sectorCount;
+    for (const Slot &slot : m_pinned)
+    {
+        ready |= slot.index == next;
+    }
+    for (const Slot &slot : m_stage)
+    {
+        ready |= slot.index == next;
+    }
+    if (!ready)
+    {
+        stage(next, servedSlot);
+    }
+}
@@ -0,0 +1,90 @@
+#include "lz4_block.h"
+
+#include <string.h>
+
+#include "pico/platform.h"
+
+// Runs from RAM: it is measured against reading the same sector through XIP, and the compressed data is
+// the only thing it should fetch from flash.
+
+static inline size_t lz4_length(const uint8_t **ip, const uint8_t *iend, size_t length)
+{
+	if (length == 15)
+	{
+		uint8_t byte;
+		do
+		{
+			if (*ip >= iend)
+			{
+				return SIZE_MAX;
+			}
+			byte = *(*ip)++;
+			length += byte;
+		} while (byte == 255);
+	}
+	return length;
+}
+
+bool __time_critical_func(lz4_decode_block)(const uint8_t *src, const size_t srcSize, uint8_t *dst, const size_t dstSize)
+{
+	const uint8_t *ip = src;
+	const uint8_t *const iend = src + srcSize;
+	uint8_t *op = dst;
+	uint8_t *const oend = dst + dstSize;
+
+	while (ip < iend)
+	{
+		const uint8_t token = *ip++;
+
+		const size_t literals = lz4_length(&ip, iend, token >> 4);
+		if (literals > (size_t) (iend - ip) || literals > (size_t) (oend - op))
+		{
+			return false;
+		}
+		memcpy(op, ip, literals);
+		ip += literals;
+		op += literals;
+
+		// The last sequence is literals only
+		if (op == oend)
+		{
+			return true;
+		}
+
+		if (iend - ip < 2)
+		{
+			return false;
+		}
+		const size_t offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if (offset == 0 || offset > (size_t) (op - dst))
+		{
+			return false;
+		}
+
+		const size_t match = lz4_length(&ip, iend, token & 15);
+		if (match == SIZE_MAX || match + 4 > (size_t) (oend - op))
+		{
+			return false;
+		}
+
+		// Byte by byte, matches may overlap what they copy
+		const uint8_t *from = op - offset;
+		const uint8_t *const matchEnd = op + match + 4;
+		if (offset >= 4)
+		{
+			while (op + 4 <= matchEnd)
+			{
+				memcpy(op, from, 4);
+				op += 4;
+				from += 4;
+			}
+		}
+		while (op < matchEnd)
+		{
+			*op++ = *from++;
+		}
+	}
+
+	return op == oend;
+}
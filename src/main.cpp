@@ -20,7 +20,8 @@ int main() {
     eccedc_init();
 
     picostation::initHW();
-    multicore_launch_core1(picostation::core1Entry);  // I2S Thread
+    multicore_launch_core1(picostation::core1Entry);  // I2S Thread, mounts the SD card during the console reset
+    picostation::bootConsole();
 
     picostation::core0Entry();  // Reset, playback speed, Sled, soct, subq
     __builtin_unreachable();
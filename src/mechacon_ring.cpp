@@ -0,0 +1,37 @@
+#include "mechacon_ring.h"
+
+#include "hardware/dma.h"
+#include "hardware/pio.h"
+#include "pico/platform.h"
+#include "values.h"
+
+picostation::MechaconRing picostation::g_mechaconRing;
+
+void picostation::MechaconRing::start()
+{
+    m_channel = dma_claim_unused_channel(true);
+
+    dma_channel_config config = dma_channel_get_default_config(m_channel);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_32);
+    channel_config_set_read_increment(&config, false);
+    channel_config_set_write_increment(&config, true);
+    channel_config_set_ring(&config, true, __builtin_ctz(sizeof(m_words)));
+    channel_config_set_dreq(&config, pio_get_dreq(PIOInstance::MECHACON, SM::MECHACON, false));
+    dma_channel_configure(m_channel, &config, m_words, &PIOInstance::MECHACON->rxf[SM::MECHACON], UINT32_MAX, true);
+}
+
+uint32_t __time_critical_func(picostation::MechaconRing::received)()
+{
+    const uint32_t remaining = dma_channel_hw_addr(m_channel)->transfer_count;
+
+    // About 2^32 bytes in, hours of traffic, start counting again; the write pointer carries on
+    if (remaining < (1u << 31))
+    {
+        dma_channel_abort(m_channel);
+        m_base += UINT32_MAX - dma_channel_hw_addr(m_channel)->transfer_count;
+        dma_channel_set_trans_count(m_channel, UINT32_MAX, true);
+        return m_base;
+    }
+
+    return m_base + (UINT32_MAX - remaining);
+}
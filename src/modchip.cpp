@@ -4,6 +4,7 @@
 
 #include "cmd.h"
 #include "disc_image.h"
+#include "hardware/dma.h"
 #include "hardware/uart.h"
 #include "logging.h"
 #include "pico/stdlib.h"
@@ -16,27 +17,110 @@
 #define DEBUG_PRINT(...) while (0)
 #endif
 
+static constexpr char s_licenseData[3][5] = {"SCEA", "SCEE", "SCEI"};
+static constexpr int c_licenseStrings = 6;           // the 3 license strings, twice each
+static constexpr uint64_t c_licenseGapUs = 90000U;   // silence before each string
+static constexpr uint32_t c_abortPollUs = 1000U;     // how often a gap checks the abort conditions
+
 void picostation::ModChip::endLicenseSequence() {
     gpio_put(Pin::SCEX_DATA, 0);
-    m_modchipTimer = time_us_64();
-    DEBUG_PRINT("-SCEX\n");
+    m_state = State::DONE;
 }
 
 void picostation::ModChip::init() {
-    uart_init(uart1, 250);
+    const uint baud = uart_init(uart1, 250);
     gpio_set_function(Pin::SCEX_DATA, GPIO_FUNC_UART);
     gpio_set_outover(Pin::SCEX_DATA, GPIO_OVERRIDE_INVERT);
     uart_set_hw_flow(uart1, false, false);
     uart_set_format(uart1, 8, 1, UART_PARITY_NONE);
     uart_set_fifo_enabled(uart1, false);
 
+    // 4 characters of start + 8 data + stop bits
+    m_stringTimeUs = (4 * 10 * 1000000U) / baud;
+
+    // The UART has no FIFO, its TX DREQ paces the DMA one character at a time
+    m_dmaChannel = dma_claim_unused_channel(true);
+    dma_channel_config c = dma_channel_get_default_config(m_dmaChannel);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, uart_get_dreq(uart1, true));
+    dma_channel_configure(m_dmaChannel, &c, &uart_get_hw(uart1)->dr, nullptr, 4, false);
+
     m_modchipTimer = time_us_64();
 }
 
+bool picostation::ModChip::conditionsHold() const {
+    const int sector = g_driveMechanics.getSector();
+    const bool inWobbleGroove = (sector > 0) && (sector < c_leadIn);
+    const bool soctDisabled = !m_mechCommand->getSoct();
+    const bool gfsSet = m_mechCommand->getSens(SENS::GFS);
+
+    return soctDisabled && gfsSet && inWobbleGroove;
+}
+
+void picostation::ModChip::startString() {
+    dma_channel_transfer_from_buffer_now(m_dmaChannel, s_licenseData[m_stringIndex % 3], 4);
+}
+
+int64_t picostation::ModChip::alarmCallback(alarm_id_t id, void *user_data) {
+    return static_cast<picostation::ModChip *>(user_data)->step();
+}
+
+// Runs from the alarm IRQ, returns the delay until it wants to run again (0 once the sequence is over)
+int64_t __time_critical_func(picostation::ModChip::step)() {
+    const uint64_t now = time_us_64();
+
+    switch (m_state) {
+        case State::GAP:
+            if (!conditionsHold()) {
+                endLicenseSequence();
+                return 0;
+            }
+            if (now >= m_gapEnd) {
+                startString();
+                m_state = State::SENDING;
+                return m_stringTimeUs;
+            }
+            return (m_gapEnd - now < c_abortPollUs) ? (int64_t)(m_gapEnd - now) : c_abortPollUs;
+
+        case State::SENDING:
+            // Wait out the stop bit of the last character, the gap counts from the line going idle
+            if (dma_channel_is_busy(m_dmaChannel) || (uart_get_hw(uart1)->fr & UART_UARTFR_BUSY_BITS)) {
+                return 100;
+            }
+            if (++m_stringIndex >= c_licenseStrings) {
+                endLicenseSequence();
+                return 0;
+            }
+            m_gapEnd = now + c_licenseGapUs;
+            m_state = State::GAP;
+            return c_abortPollUs;
+
+        default:
+            return 0;
+    }
+}
+
 void picostation::ModChip::sendLicenseString(const int sector, MechCommand &mechCommand) {
-    static constexpr char s_licenseData[3][5] = {"SCEA", "SCEE", "SCEI"};
     static int modchip_hysteresis = 0;
 
+    switch (m_state) {
+        case State::IDLE:
+            break;
+
+        case State::DONE:
+            DEBUG_PRINT("-SCEX\n");
+            mechCommand.setBootSectorPattern(255);
+            modchip_hysteresis = 0;
+            m_modchipTimer = time_us_64();
+            m_state = State::IDLE;
+            return;
+
+        default:
+            return;  // the alarm is sending, the sector pipeline carries on
+    }
+
     // Gather all conditions in one place
     const bool inWobbleGroove = (sector > 0) && (sector < c_leadIn);
     const bool isDataDisc = g_discImage.hasData();
@@ -45,23 +129,6 @@ void picostation::ModChip::sendLicenseString(const int sector, MechCommand &mech
     const bool shouldActivateModchip = inWobbleGroove && gfsSet && soctDisabled && isDataDisc;
     const uint64_t timeElapsed = time_us_64() - m_modchipTimer;
 
-    // Helper function to wait with abort conditions
-    auto waitWithAbort = [&mechCommand, this](const uint64_t waitTimeUS) -> bool {
-        const uint64_t startTime = time_us_64();
-        while ((time_us_64() - startTime) < waitTimeUS) {
-            const int sector = g_driveMechanics.getSector();
-            const bool inWobbleGroove = (sector > 0) && (sector < c_leadIn);
-            const bool soctDisabled = !mechCommand.getSoct();
-            const bool gfsSet = mechCommand.getSens(SENS::GFS);
-
-            if (!soctDisabled || !gfsSet || !inWobbleGroove) {
-                return false;
-            }
-            sleep_us(50);
-        }
-        return true;
-    };
-
     if (shouldActivateModchip) {
         if (timeElapsed > 13333) {
             modchip_hysteresis++;
@@ -71,15 +138,13 @@ void picostation::ModChip::sendLicenseString(const int sector, MechCommand &mech
                 modchip_hysteresis = 0;
                 DEBUG_PRINT("+SCEX\n");
 
-                // Send the 3 license strings, twice each
-                for (int i = 0; i < 6 && waitWithAbort(90000U); i++) {
-                    DEBUG_PRINT("%s\n", s_licenseData[i % 3]);
-                    uart_puts(uart1, s_licenseData[i % 3]);
-                    uart_tx_wait_blocking(uart1);
+                m_mechCommand = &mechCommand;
+                m_stringIndex = 0;
+                m_gapEnd = time_us_64() + c_licenseGapUs;
+                m_state = State::GAP;
+                if (add_alarm_in_us(c_abortPollUs, alarmCallback, this, true) < 0) {
+                    m_state = State::IDLE;  // no alarm slot, try again after the next hysteresis
                 }
-
-                endLicenseSequence();
-                mechCommand.setBootSectorPattern(255);
             }
         }
     } else {
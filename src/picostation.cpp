@@ -7,14 +7,18 @@
 #include "disc_image.h"
 #include "directory_listing.h"
 #include "drive_mechanics.h"
+#include "hardware/dma.h"
 #include "hardware/pwm.h"
 #include <hardware/i2c.h>
 #include "i2s.h"
 #include "logging.h"
 #include "main.pio.h"
+#include "mechacon_ring.h"
 #include "pico/multicore.h"
 #include "pico/stdlib.h"
 #include "pseudo_atomics.h"
+#include "sector_worker.h"
+#include "stats.h"
 #include "subq.h"
 #include "values.h"
 #include "si5351.h"
@@ -49,13 +53,17 @@ pseudoatomic<bool> picostation::g_coreReady[2];
 unsigned int picostation::g_audioCtrlMode = audioControlModes::NORMAL;
 
 pseudoatomic<picostation::FileListingStates> picostation::g_fileListingState;
-pseudoatomic<uint32_t> picostation::g_fileArg;
+picostation::SpscQueue<picostation::MenuCommand, 8> picostation::g_menuCommands;
+pseudoatomic<uint32_t> picostation::g_menuCommandsLatched;
+pseudoatomic<uint32_t> picostation::g_menuCommandsQueued;
 
 static unsigned int s_mechachonOffset;
 unsigned int picostation::g_soctOffset;
 unsigned int picostation::g_subqOffset;
 
 static uint8_t s_resetPending = 0;
+static uint64_t s_subqDueTime = 0;  // core0: r/w
+static volatile uint32_t s_soctRaisedAt = 0;  // core0: SOCT FIFO IRQ time, for response stats
 
 static picostation::PWMSettings pwmDataClock = 
 {
@@ -86,6 +94,32 @@ static picostation::PWMSettings pwmMainClock =
 
 static void initPWM(picostation::PWMSettings *settings);
 
+// Keeps the mechacon TX FIFO full of the current SENS mask (see main.pio). A transfer count runs out
+// after about 2^32 pulls, hours of mechacon traffic, so it is rewound at a latch well before that.
+static int s_sensFeedChannel = -1;
+
+static void sens_feed_start()
+{
+    s_sensFeedChannel = dma_claim_unused_channel(true);
+
+    dma_channel_config config = dma_channel_get_default_config(s_sensFeedChannel);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_32);
+    channel_config_set_read_increment(&config, false);
+    channel_config_set_write_increment(&config, false);
+    channel_config_set_dreq(&config, pio_get_dreq(PIOInstance::MECHACON, SM::MECHACON, true));
+    dma_channel_configure(s_sensFeedChannel, &config, &PIOInstance::MECHACON->txf[SM::MECHACON],
+                          m_mechCommand.getSensMask(), UINT32_MAX, true);
+}
+
+static inline void __time_critical_func(sens_feed_check)()
+{
+    if (dma_channel_hw_addr(s_sensFeedChannel)->transfer_count < (1u << 31))
+    {
+        dma_channel_abort(s_sensFeedChannel);
+        dma_channel_set_trans_count(s_sensFeedChannel, UINT32_MAX, true);
+    }
+}
+
 static void __time_critical_func(interruptHandler)(unsigned int gpio, uint32_t events)
 {
     static uint64_t lastLowEvent = 0;
@@ -157,22 +191,35 @@ static void __time_critical_func(interruptHandler)(unsigned int gpio, uint32_t e
 
         case Pin::XLAT:
         {
+            m_mechCommand.updateMech();
             m_mechCommand.processLatchedCommand();
+            sens_feed_check();
         } break;
     }
 }
 
-static void __time_critical_func(mech_irq_hnd)()
+// The FIFO level stays up until core0's loop drains it, so the source masks itself; the taken IRQ is
+// what wakes the loop from WFE
+static void __time_critical_func(soct_irq_hnd)()
+{
+	pio_set_irq1_source_enabled(PIOInstance::SOCT, (enum pio_interrupt_source)(pis_sm0_rx_fifo_not_empty + SM::SOCT), false);
+	s_soctRaisedAt = time_us_32();
+}
+
+static inline void __time_critical_func(recordResponse)(const uint32_t raisedAt)
 {
-	// Update latching
-	m_mechCommand.updateMech();
-	pio_interrupt_clear(PIOInstance::MECHACON, 0);
+	STATS_MAX(core0WorstResponseUs, time_us_32() - raisedAt);
 }
 
 static void __time_critical_func(send_subq)(const int Sector)
 {
 	picostation::SubQ subq(&picostation::g_discImage);
 	
+	const uint64_t lateUs = time_us_64() - s_subqDueTime;
+	STATS_INC(subqAlarms);
+	STATS_ADD(subqLateUs, lateUs);
+	STATS_MAX(subqWorstLateUs, lateUs);
+	
 	subq.start_subq(Sector);
 	picostation::g_subqDelay = false;
 }
@@ -190,30 +237,21 @@ static void __time_critical_func(send_subq)(const int Sector)
 #define CONT_SM_DAT 1
 #define PAD_READ 0x42
 
-typedef enum {
-    WAIT_CMD,
-    WAIT_TAP,
-    WAIT_DAT0,
-    WAIT_DAT1
-} ContState;
-
 enum Action {
 	ACTION_NONE,
 	ACTION_SHORT_RESET,
 	ACTION_LONG_RESET
 };
 
-ContState contState = WAIT_CMD;
-static uint8_t dat0 = 0;
 volatile Action detected_action = ACTION_NONE;
 volatile bool ready_to_process = false;
-static bool cont_frame_consumed = false;
 static bool combo_lock = false;
 
-static absolute_time_t frame_start_time;
-static bool valid_pad_frame = false;
+// Pad read frames from the DAT reader, bytes 2-4 in the top three bytes of each word. Written by DMA,
+// the PIO IRQ looks at the newest one.
+static uint32_t s_contFrames[4] __attribute__((aligned(sizeof(uint32_t) * 4)));
+static int s_contChannel = -1;
 
-// Contagem de hold
 static uint32_t hold_frames = 0;
 #define HOLD_FRAMES_500MS 30   // ~500 ms a 60Hz
 
@@ -264,7 +302,7 @@ static inline void controller_cmd_init(PIO pio, uint sm, uint offset)
     pio_sm_set_consecutive_pindirs(pio, sm, Pin::CONT_ATT, 1, false);
     pio_sm_set_consecutive_pindirs(pio, sm, Pin::CONT_CLK, 1, false);
 
-    sm_config_set_in_shift(&c, true, true, 8);
+    sm_config_set_in_shift(&c, false, false, 32);
     sm_config_set_fifo_join(&c, PIO_FIFO_JOIN_RX);
     sm_config_set_clkdiv(&c, CONT_CLKDIV);
 
@@ -281,137 +319,92 @@ static inline void controller_dat_init(PIO pio, uint sm, uint offset)
     pio_sm_set_consecutive_pindirs(pio, sm, Pin::CONT_ATT, 1, false);
     pio_sm_set_consecutive_pindirs(pio, sm, Pin::CONT_CLK, 1, false);
 
-    sm_config_set_in_shift(&c, true, true, 8);
+    sm_config_set_in_shift(&c, true, true, 24);
     sm_config_set_fifo_join(&c, PIO_FIFO_JOIN_RX);
     sm_config_set_clkdiv(&c, CONT_CLKDIV);
 
     pio_sm_init(pio, sm, offset, &c);
 }
 
-static inline uint8_t cont_read(PIO pio, uint sm){
-    return (uint8_t)(pio_sm_get(pio, sm) >> 24);
-}
-
-void controller_init(void){
-    uint off_cmd = pio_add_program(CONT_PIO, &controller_cmd_program);
-    uint off_dat = pio_add_program(CONT_PIO, &controller_dat_program);
-    controller_cmd_init(CONT_PIO, CONT_SM_CMD, off_cmd);
-    controller_dat_init(CONT_PIO, CONT_SM_DAT, off_dat);
-    pio_sm_set_enabled(CONT_PIO, CONT_SM_CMD, true);
-    pio_sm_set_enabled(CONT_PIO, CONT_SM_DAT, true);
-}
-
-void __time_critical_func(controller_poll)(){
-    switch (contState)
-    {
-        case WAIT_CMD:
-        {
-            if (gpio_get(Pin::CONT_ATT) == 0) {
-                cont_frame_consumed = false;
-                frame_start_time = get_absolute_time();
-            }
-
-            if (cont_frame_consumed)
-                return;
-
-            if (pio_sm_is_rx_fifo_empty(CONT_PIO, CONT_SM_CMD))
-                return;
+// One complete pad read, from the PIO IRQ
+static void __time_critical_func(controller_frame)(const uint32_t frame)
+{
+    // An ATT cut short leaves the DAT reader out of step, the 0x5A after the ID catches it
+    if (((frame >> 8) & 0xFF) != 0x5A) {
+        return;
+    }
 
-            uint8_t cmd = cont_read(CONT_PIO, CONT_SM_CMD);
+    uint16_t buttons = (frame >> 16) ^ 0xFFFF;
 
-            if (cmd == PAD_READ) {
-                valid_pad_frame = true;
-                contState = WAIT_TAP;
-            } else {
-                // não é leitura de controle
-                valid_pad_frame = false;
-                cont_frame_consumed = true;
-                contState = WAIT_CMD;
-            }
-            break;
-        }
+    bool short_reset_now =
+        ((buttons & MASK_SHORT_RESET) == MASK_SHORT_RESET);
 
-        case WAIT_TAP:
-        {
-            if (pio_sm_is_rx_fifo_empty(CONT_PIO, CONT_SM_CMD))
-                return;
+    bool long_reset_now =
+        ((buttons & MASK_LONG_RESET) == MASK_LONG_RESET);
 
-            // Ignora TAP
-            cont_read(CONT_PIO, CONT_SM_CMD);
-            contState = WAIT_DAT0;
-            break;
-        }
-
-        case WAIT_DAT0:
-        {
-            if (pio_sm_is_rx_fifo_empty(CONT_PIO, CONT_SM_DAT))
-                return;
+    // ================= HOLD 500ms =================
+    if (short_reset_now || long_reset_now) {
+        hold_frames++;
+    } else {
+        hold_frames = 0;
+    }
 
-            dat0 = cont_read(CONT_PIO, CONT_SM_DAT);
-            contState = WAIT_DAT1;
-            break;
+    if (hold_frames >= HOLD_FRAMES_500MS && !combo_lock) {
+        if (short_reset_now) {
+            detected_action = ACTION_SHORT_RESET;
+        } else if (long_reset_now) {
+            detected_action = ACTION_LONG_RESET;
         }
+        ready_to_process = true;
+        combo_lock = true;
+    }
 
-        case WAIT_DAT1:
-        {
-            if (pio_sm_is_rx_fifo_empty(CONT_PIO, CONT_SM_DAT))
-                return;
-
-            uint8_t dat1 = cont_read(CONT_PIO, CONT_SM_DAT);
-
-            // Ignora se não for frame válido de controle
-            if (!valid_pad_frame) {
-                cont_frame_consumed = true;
-                contState = WAIT_CMD;
-                return;
-            }
-
-            // Ignora frame longo (memory card)
-            int64_t frame_us =
-                absolute_time_diff_us(frame_start_time, get_absolute_time());
+    // Libera ao soltar
+    if (!short_reset_now && !long_reset_now) {
+        combo_lock = false;
+        hold_frames = 0;
+    }
+}
 
-            if (frame_us > 1000) { // > 1 ms = suspeito
-                cont_frame_consumed = true;
-                contState = WAIT_CMD;
-                return;
-            }
+// Each pad read is one DMA transfer, re-armed here; everything else on the port never reaches the CPU.
+// A frame that comes in before that waits in the RX FIFO and raises this again.
+static void __time_critical_func(controller_irq_hnd)()
+{
+    dma_channel_acknowledge_irq0(s_contChannel);
 
-            uint16_t buttons = (dat1 | (dat0 << 8)) ^ 0xFFFF;
+    // The write address carries on round the ring, the newest frame is the one before it
+    const uint32_t *next = (const uint32_t *) dma_channel_hw_addr(s_contChannel)->write_addr;
+    controller_frame(s_contFrames[(next - s_contFrames - 1) & 3]);
 
-            bool short_reset_now =
-                ((buttons & MASK_SHORT_RESET) == MASK_SHORT_RESET);
+    dma_channel_set_trans_count(s_contChannel, 1, true);
+}
 
-            bool long_reset_now =
-                ((buttons & MASK_LONG_RESET) == MASK_LONG_RESET);
+void controller_init(void){
+    uint off_cmd = pio_add_program(CONT_PIO, &controller_cmd_program);
+    uint off_dat = pio_add_program(CONT_PIO, &controller_dat_program);
+    controller_cmd_init(CONT_PIO, CONT_SM_CMD, off_cmd);
+    controller_dat_init(CONT_PIO, CONT_SM_DAT, off_dat);
 
-            // ================= HOLD 500ms =================
-            if (short_reset_now || long_reset_now) {
-                hold_frames++;
-            } else {
-                hold_frames = 0;
-            }
+    // The CMD reader compares the second command byte against Y
+    pio_sm_put(CONT_PIO, CONT_SM_CMD, (uint32_t) PAD_READ << 24);
+    pio_sm_exec(CONT_PIO, CONT_SM_CMD, pio_encode_pull(false, false));
+    pio_sm_exec(CONT_PIO, CONT_SM_CMD, pio_encode_mov(pio_y, pio_osr));
 
-            if (hold_frames >= HOLD_FRAMES_500MS && !combo_lock) {
-                if (short_reset_now) {
-                    detected_action = ACTION_SHORT_RESET;
-                } else if (long_reset_now) {
-                    detected_action = ACTION_LONG_RESET;
-                }
-                ready_to_process = true;
-                combo_lock = true;
-            }
+    s_contChannel = dma_claim_unused_channel(true);
+    dma_channel_config config = dma_channel_get_default_config(s_contChannel);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_32);
+    channel_config_set_read_increment(&config, false);
+    channel_config_set_write_increment(&config, true);
+    channel_config_set_ring(&config, true, __builtin_ctz(sizeof(s_contFrames)));
+    channel_config_set_dreq(&config, pio_get_dreq(CONT_PIO, CONT_SM_DAT, false));
+    dma_channel_configure(s_contChannel, &config, s_contFrames, &CONT_PIO->rxf[CONT_SM_DAT], 1, true);
 
-            // Libera ao soltar
-            if (!short_reset_now && !long_reset_now) {
-                combo_lock = false;
-                hold_frames = 0;
-            }
+    dma_channel_set_irq0_enabled(s_contChannel, true);
+    irq_set_exclusive_handler(DMA_IRQ_0, controller_irq_hnd);
+    irq_set_enabled(DMA_IRQ_0, true);
 
-            cont_frame_consumed = true;
-            contState = WAIT_CMD;
-            break;
-        }
-    }
+    pio_sm_set_enabled(CONT_PIO, CONT_SM_CMD, true);
+    pio_sm_set_enabled(CONT_PIO, CONT_SM_DAT, true);
 }
 #endif
 //=====================================================
@@ -438,6 +431,9 @@ void __time_critical_func(controller_poll)(){
 			reset();
 		}
 
+        // What the XLAT IRQ left for later, before the SOCT check below needs its state machine
+        m_mechCommand.processDeferredCommands();
+
         const int currentSector = g_driveMechanics.getSector();
 
         // Limit Switch
@@ -445,6 +441,7 @@ void __time_critical_func(controller_poll)(){
 
         updatePlaybackSpeed();
 
+        // Each branch handles whatever woke the loop; it then sleeps below until the next IRQ or SEV
         // Soct/Sled/seek
         if (m_mechCommand.getSoct())
         {
@@ -453,20 +450,39 @@ void __time_critical_func(controller_poll)(){
                 pio_sm_drain_tx_fifo(PIOInstance::SOCT, SM::SOCT);
                 m_mechCommand.setSoct(false);
                 pio_sm_set_enabled(PIOInstance::SOCT, SM::SOCT, false);
+                if (s_soctRaisedAt)
+                {
+                    recordResponse(s_soctRaisedAt);
+                    s_soctRaisedAt = 0;
+                }
+            }
+            else
+            {
+                pio_set_irq1_source_enabled(PIOInstance::SOCT, (enum pio_interrupt_source)(pis_sm0_rx_fifo_not_empty + SM::SOCT), true);
             }
         }
         else if (!g_driveMechanics.isSledStopped())
         {
-            g_driveMechanics.moveSled(m_mechCommand);
+            // The sled timer counts tracks and toggles COUT from its own IRQ
         }
         else if (m_mechCommand.getSens(SENS::GFS))
         {
             if (m_i2s.getSectorSending() == currentSector)
             {
+                // Only while playing through, after a seek the sector may have gone out long before
+                static int lastMovedSector = -1;
+                if (currentSector == lastMovedSector + 1)
+                {
+                    recordResponse((uint32_t)m_i2s.getLastSectorTime());
+                }
+                lastMovedSector = currentSector;
+
                 g_driveMechanics.moveToNextSector();
                 g_subqDelay = true;
 
-                add_alarm_in_us(time_us_64() - m_i2s.getLastSectorTime() + c_MaxSubqDelayTime,
+                const uint64_t subqDelay = time_us_64() - m_i2s.getLastSectorTime() + c_MaxSubqDelayTime;
+                s_subqDueTime = time_us_64() + subqDelay;
+                add_alarm_in_us(subqDelay,
 					[](alarm_id_t id, void *user_data) -> int64_t {
 						send_subq((const int) user_data);
 						return 0;
@@ -474,8 +490,10 @@ void __time_critical_func(controller_poll)(){
             }
         }
 
+        // Spare time, one stage of core1's read-ahead sector work
+        g_sectorWorker.run();
+
         #if CONTROLLER_SNIFF
-            controller_poll();
             if (ready_to_process) {
     			ready_to_process = false;
     			switch (detected_action) {
@@ -500,6 +518,12 @@ void __time_critical_func(controller_poll)(){
     		}    
         #endif
 
+        // Sleep until an IRQ (XLAT, SOCT, controller, reset/door, sled timer, SubQ alarm) or core1
+        // (sector sent, worker job) raises an event
+        if (!g_sectorWorker.pending() && !s_resetPending)
+        {
+            __wfe();
+        }
     }
 }
 
@@ -521,6 +545,7 @@ void __time_critical_func(picostation::initHW)()
     DEBUG_PRINT("Initializing...\n");
 
     mutex_init(&g_mechaconMutex);
+    g_driveMechanics.init();
 
     for (const unsigned int pin : Pin::allPins)
     {
@@ -583,6 +608,7 @@ void __time_critical_func(picostation::initHW)()
 		si5351_SetupCLK2(53693175, SI5351_DRIVE_STRENGTH_8MA);
 		si5351_EnableOutputs((1<<1) | (1<<2));
 	}
+    stats_boot_phase(BOOT_PHASE_CLOCKS);
 
     initPWM(&pwmMainClock);
     initPWM(&pwmDataClock);
@@ -592,7 +618,10 @@ void __time_critical_func(picostation::initHW)()
     i2s_data_program_init(PIOInstance::I2S_DATA, SM::I2S_DATA, i2s_pio_offset, Pin::DA15, Pin::DA16);
 
     s_mechachonOffset = pio_add_program(PIOInstance::MECHACON, &mechacon_program);
-    mechacon_program_init(PIOInstance::MECHACON, SM::MECHACON, s_mechachonOffset, Pin::CMD_DATA);
+    mechacon_program_init(PIOInstance::MECHACON, SM::MECHACON, s_mechachonOffset, Pin::CMD_DATA, Pin::SENS);
+    sens_feed_start();
+    g_mechaconRing.start();
+    m_mechCommand.refreshSens();  // reads the ring, so after its channel is claimed
 
     g_soctOffset = pio_add_program(PIOInstance::SOCT, &soct_program);
     g_subqOffset = pio_add_program(PIOInstance::SUBQ, &subq_program);
@@ -600,6 +629,23 @@ void __time_critical_func(picostation::initHW)()
     pio_sm_set_enabled(PIOInstance::I2S_DATA, SM::I2S_DATA, true);
     pwm_set_mask_enabled((1 << pwmLRClock.sliceNum) | (1 << pwmDataClock.sliceNum) | (1 << pwmMainClock.sliceNum));
 
+    // The sled timer only counts, any slice the clocks leave free will do
+    unsigned int sledSlice = 0;
+    while (sledSlice == pwmLRClock.sliceNum || sledSlice == pwmDataClock.sliceNum || sledSlice == pwmMainClock.sliceNum)
+    {
+        sledSlice++;
+    }
+    g_driveMechanics.initSledTimer(sledSlice, m_mechCommand);
+
+    g_coreReady[0] = false;
+    g_coreReady[1] = false;
+
+    stats_boot_phase(BOOT_PHASE_HW);
+}
+
+// Holds the console in reset and lets it come back up, while core1 is already mounting the SD card
+void __time_critical_func(picostation::bootConsole)()
+{
     uint64_t startTime = time_us_64();
     gpio_set_dir(Pin::RESET, GPIO_OUT);
     gpio_put(Pin::RESET, 0);
@@ -628,20 +674,16 @@ void __time_critical_func(picostation::initHW)()
 
     pio_sm_set_enabled(PIOInstance::MECHACON, SM::MECHACON, true);
     
-    pio_set_irq0_source_enabled(PIOInstance::MECHACON, (enum pio_interrupt_source)pis_interrupt0, true);
-    
-    
-    pio_interrupt_clear(PIOInstance::MECHACON, 0);
-    irq_set_exclusive_handler(PIO0_IRQ_0, mech_irq_hnd);
-    irq_set_enabled(PIO0_IRQ_0, true);
 
-    g_coreReady[0] = false;
-    g_coreReady[1] = false;
+    // SOCT results, armed by core0's loop while SOCT is on
+    irq_set_exclusive_handler(PIO0_IRQ_1, soct_irq_hnd);
+    irq_set_enabled(PIO0_IRQ_1, true);
 
     #if CONTROLLER_SNIFF
         controller_init();
     #endif
 
+    stats_boot_phase(BOOT_PHASE_CONSOLE);
     DEBUG_PRINT("ON!\n");
 }
 
@@ -667,12 +709,14 @@ void __time_critical_func(picostation::updatePlaybackSpeed)()
     {
         s_currentPlaybackSpeed = g_targetPlaybackSpeed;
         const unsigned int clock_div = (s_currentPlaybackSpeed == 1) ? c_clockDivNormal : c_clockDivDouble;
-        pwm_set_mask_enabled(0);
+        // Restart the clocks together, leaving the sled timer running
+        const uint32_t clocks = (1 << pwmLRClock.sliceNum) | (1 << pwmDataClock.sliceNum) | (1 << pwmMainClock.sliceNum);
+        hw_clear_bits(&pwm_hw->en, clocks);
         pwm_config_set_clkdiv_int(&pwmDataClock.config, clock_div);
         pwm_config_set_clkdiv_int(&pwmLRClock.config, clock_div);
         pwm_hw->slice[pwmDataClock.sliceNum].div = pwmDataClock.config.div;
         pwm_hw->slice[pwmLRClock.sliceNum].div = pwmLRClock.config.div;
-        pwm_set_mask_enabled((1 << pwmLRClock.sliceNum) | (1 << pwmDataClock.sliceNum) | (1 << pwmMainClock.sliceNum));
+        hw_set_bits(&pwm_hw->en, clocks);
         DEBUG_PRINT("x%i\n", s_currentPlaybackSpeed);
     }
 }
@@ -694,27 +738,25 @@ void __time_critical_func(picostation::reset)()
     
     if (s_resetPending == 2)
     {
-        if (s_dataLocation != picostation::DiscImage::DataLocation::RAM)
-		{
-			g_discImage.unload();
-			g_discImage.makeDummyCue();
-			m_i2s.menu_active = true;
-			g_discImage.set_skip_bootsector(false);
-			g_discImage.set_skip_edc(false);
-            m_mechCommand.resetBootSectorPattern();
-		}
-		picostation::DirectoryListing::gotoRoot();
-		s_dataLocation = picostation::DiscImage::DataLocation::RAM;
+        m_i2s.requestMenuReturn();
     }
 
-    mechacon_program_init(PIOInstance::MECHACON, SM::MECHACON, s_mechachonOffset, Pin::CMD_DATA);
+    mechacon_program_init(PIOInstance::MECHACON, SM::MECHACON, s_mechachonOffset, Pin::CMD_DATA, Pin::SENS);
+    m_mechCommand.refreshSens();
     g_subqDelay = false;
     m_mechCommand.setSoct(false);
 
     gpio_put(Pin::SCOR, 0);
     gpio_put(Pin::SQSO, 0);
 	g_driveMechanics.resetDrive();
-	m_i2s.reinitI2S();
+    if (s_resetPending == 2)
+    {
+        m_i2s.requestReinitI2S();
+    }
+    else
+    {
+        m_i2s.warmResetI2S();
+    }
     g_discImage.set_skip_bootsector(false);
     m_mechCommand.resetBootSectorPattern();
 	
@@ -0,0 +1,252 @@
+#include "run_profile.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "ff.h"
+#include "hardware/timer.h"
+#include "logging.h"
+#include "pico/platform.h"
+#include "values.h"
+
+#if DEBUG_FILEIO
+#define DEBUG_PRINT(...) printf(__VA_ARGS__)
+#else
+#define DEBUG_PRINT(...) while (0)
+#endif
+
+static constexpr int c_minRunLength = 16;       // shorter reads are not worth remembering
+static constexpr int c_successorLead = 8;       // sectors before the end of a run to look at the next one
+static constexpr int c_successorDepth = 8;      // sectors of the next run to read ahead
+static constexpr uint64_t c_flushDelayUs = 5000000;
+
+static FIL s_hintsFile;
+
+picostation::RunProfile picostation::g_runProfile;
+
+void picostation::RunProfile::open(const char *cuePath)
+{
+    close();
+
+    strncpy(m_path, cuePath, c_maxFilePathLength);
+    m_path[c_maxFilePathLength] = 0;
+
+    char *ext = strrchr(m_path, '.');
+    if (!ext || strchr(ext, '/'))
+    {
+        ext = m_path + strlen(m_path);
+    }
+    if ((size_t)(ext - m_path) + 4 > c_maxFilePathLength)
+    {
+        return;
+    }
+    strcpy(ext, ".hnt");
+
+    m_count = 0;
+    m_open = true;
+    m_dirty = false;
+    m_runStart = -1;
+    m_lastSector = -1;
+    m_lastRun = c_noRun;
+    m_currentRun = c_noRun;
+
+    if (f_open(&s_hintsFile, m_path, FA_READ) != FR_OK)
+    {
+        return;
+    }
+
+    FileHeader header;
+    UINT br;
+    if (f_read(&s_hintsFile, &header, sizeof(header), &br) == FR_OK && br == sizeof(header) &&
+        header.magic == c_fileMagic && header.version == c_fileVersion)
+    {
+        const uint16_t count = std::min<uint16_t>(header.count, c_maxRuns);
+        if (f_read(&s_hintsFile, m_runs, count * sizeof(Run), &br) == FR_OK && br == count * sizeof(Run))
+        {
+            m_count = count;
+            for (size_t i = 0; i < m_count; i++)
+            {
+                if (m_runs[i].next >= m_count)
+                {
+                    m_runs[i].next = c_noRun;
+                }
+            }
+        }
+    }
+    f_close(&s_hintsFile);
+
+    DEBUG_PRINT("hints: %s, %u runs\n", m_path, m_count);
+}
+
+void picostation::RunProfile::close()
+{
+    if (!m_open)
+    {
+        return;
+    }
+
+    closeRun();
+    if (m_dirty)
+    {
+        save();
+    }
+    m_open = false;
+}
+
+picostation::RunProfile::Prediction __time_critical_func(picostation::RunProfile::record)(const int sector)
+{
+    Prediction prediction = {0, 0, false};
+    if (!m_open || sector == m_lastSector)
+    {
+        return prediction;
+    }
+
+    if (sector == m_lastSector + 1)
+    {
+        m_lastSector = sector;
+
+        // Near the end of a known run, the run usually read next is the following seek
+        if (m_currentRun != c_noRun)
+        {
+            const Run &run = m_runs[m_currentRun];
+            if (run.next != c_noRun && sector == (int)(run.start + run.length) - c_successorLead)
+            {
+                const Run &next = m_runs[run.next];
+                prediction = {(int)next.start, (int)next.start + std::min<int>(next.length, c_successorDepth), false};
+            }
+        }
+        return prediction;
+    }
+
+    closeRun();
+    m_runStart = sector;
+    m_lastSector = sector;
+
+    m_currentRun = findRun(sector);
+    if (m_currentRun != c_noRun)
+    {
+        const Run &run = m_runs[m_currentRun];
+        prediction = {sector + 1, (int)(run.start + run.length), true};
+    }
+    return prediction;
+}
+
+void picostation::RunProfile::flushIfIdle()
+{
+    if (m_open && m_dirty && (time_us_64() - m_dirtySince) > c_flushDelayUs)
+    {
+        save();
+    }
+}
+
+// Known run containing sector or starting just after it
+uint16_t picostation::RunProfile::findRun(const int sector) const
+{
+    uint16_t best = c_noRun;
+    for (uint16_t i = 0; i < m_count; i++)
+    {
+        const int start = m_runs[i].start;
+        if (sector >= start - c_landingSlack && sector < start + m_runs[i].length &&
+            (best == c_noRun || abs(start - sector) < abs((int)m_runs[best].start - sector)))
+        {
+            best = i;
+        }
+    }
+    return best;
+}
+
+void picostation::RunProfile::closeRun()
+{
+    if (m_runStart < 0 || (m_lastSector - m_runStart + 1) < c_minRunLength)
+    {
+        return;
+    }
+
+    const uint16_t run = storeRun(m_runStart, m_lastSector + 1);
+    if (m_lastRun != c_noRun && m_lastRun != run && m_runs[m_lastRun].next != run)
+    {
+        m_runs[m_lastRun].next = run;
+        m_dirty = true;
+    }
+    m_lastRun = run;
+    m_runStart = -1;
+
+    if (m_dirty && !m_dirtySince)
+    {
+        m_dirtySince = time_us_64();
+    }
+}
+
+uint16_t picostation::RunProfile::storeRun(const uint32_t start, const uint32_t end)
+{
+    const uint32_t length = std::min<uint32_t>(end - start, UINT16_MAX);
+
+    uint16_t i = findRun(start);
+    if (i != c_noRun)
+    {
+        // Same run landed on a little differently, keep the union
+        Run &run = m_runs[i];
+        const uint32_t mergedStart = std::min(run.start, start);
+        const uint32_t mergedEnd = std::max(run.start + run.length, start + length);
+        if (mergedStart != run.start || (mergedEnd - mergedStart) != run.length)
+        {
+            run.start = mergedStart;
+            run.length = std::min<uint32_t>(mergedEnd - mergedStart, UINT16_MAX);
+            m_dirty = true;
+        }
+        run.hits = std::min<uint32_t>(run.hits + 1, UINT16_MAX);
+        return i;
+    }
+
+    if (m_count < c_maxRuns)
+    {
+        i = m_count++;
+    }
+    else
+    {
+        // Replace the least used run, and anything that pointed at it
+        i = 0;
+        for (uint16_t j = 1; j < m_count; j++)
+        {
+            if (j != m_lastRun && m_runs[j].hits < m_runs[i].hits)
+            {
+                i = j;
+            }
+        }
+        for (uint16_t j = 0; j < m_count; j++)
+        {
+            if (m_runs[j].next == i)
+            {
+                m_runs[j].next = c_noRun;
+            }
+        }
+    }
+
+    m_runs[i] = {start, (uint16_t)length, c_noRun, 1, 0};
+    m_dirty = true;
+    return i;
+}
+
+void picostation::RunProfile::save()
+{
+    m_dirty = false;
+    m_dirtySince = 0;
+
+    FRESULT fr = f_open(&s_hintsFile, m_path, FA_WRITE | FA_CREATE_ALWAYS);
+    if (fr != FR_OK)
+    {
+        DEBUG_PRINT("hints: f_open error: (%d)\n", fr);
+        return;
+    }
+
+    const FileHeader header = {c_fileMagic, c_fileVersion, m_count};
+    UINT bw;
+    f_write(&s_hintsFile, &header, sizeof(header), &bw);
+    f_write(&s_hintsFile, m_runs, m_count * sizeof(Run), &bw);
+    f_close(&s_hintsFile);
+
+    DEBUG_PRINT("hints: saved %u runs\n", m_count);
+}
@@ -0,0 +1,105 @@
+#include "sector_worker.h"
+
+#include "disc_image.h"
+#include "edc.h"
+#include "ff.h"
+#include "pico/platform.h"
+#include "stats.h"
+
+picostation::SectorWorker picostation::g_sectorWorker;
+
+picostation::SectorJob *__time_critical_func(picostation::SectorWorker::acquire)()
+{
+    for (size_t i = 0; i < c_jobs; i++)
+    {
+        if (!m_busy[i])
+        {
+            m_busy[i] = true;
+            return &m_jobs[i];
+        }
+    }
+    return nullptr;
+}
+
+picostation::SectorJob *__time_critical_func(picostation::SectorWorker::collect)()
+{
+    SectorJob *job;
+    if (!m_finished.pop(job))
+    {
+        return nullptr;
+    }
+
+    release(job);
+    return job;
+}
+
+bool __time_critical_func(picostation::SectorWorker::inFlight)(const int sector) const
+{
+    for (size_t i = 0; i < c_jobs; i++)
+    {
+        if (m_busy[i] && m_jobs[i].sector == sector)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool __time_critical_func(picostation::SectorWorker::slotInFlight)(const uint8_t slot) const
+{
+    for (size_t i = 0; i < c_jobs; i++)
+    {
+        if (m_busy[i] && m_jobs[i].slot == slot)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool __time_critical_func(picostation::SectorWorker::busy)() const
+{
+    for (size_t i = 0; i < c_jobs; i++)
+    {
+        if (m_busy[i])
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void __time_critical_func(picostation::SectorWorker::run)()
+{
+    if (!m_current)
+    {
+        if (!m_submitted.pop(m_current))
+        {
+            return;
+        }
+        m_stage = 0;
+    }
+
+    if (m_stage == 0)
+    {
+        if (DiscImage::needsEdc(m_current->raw))
+        {
+            eccedc_generate(m_current->raw);
+            STATS_INC(edcRegenerations);
+        }
+    }
+    else
+    {
+        constexpr size_t c_stageWords = 1176 / c_scrambleStages;
+        const size_t offset = (m_stage - 1) * c_stageWords;
+        scramble_data(m_current->samples + offset, (uint16_t *)m_current->raw + offset, m_current->scrambling + offset,
+                      c_stageWords);
+    }
+
+    if (++m_stage > c_scrambleStages)
+    {
+        STATS_INC(workerSectors);
+        m_finished.push(m_current);
+        m_current = nullptr;
+    }
+}
@@ -0,0 +1,72 @@
+#include "stats.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include "pico/time.h"
+
+#define STATS_SECTOR_WORDS 1162
+#define STATS_DATA_OFFSET 138  // same layout as the config sector
+
+stats_counters_t g_stats[2];
+
+static stats_counters_t s_snapshot;
+static uint32_t s_snapshotTimeMs;
+static uint32_t s_bootPhaseUs[BOOT_PHASE_COUNT];
+
+void stats_reset(void)
+{
+	memset(g_stats, 0, sizeof(g_stats));
+}
+
+void stats_boot_phase(const boot_phase_t phase)
+{
+	if (!s_bootPhaseUs[phase])
+	{
+		s_bootPhaseUs[phase] = time_us_32();
+	}
+}
+
+void stats_snapshot(void)
+{
+	const uint32_t *core0 = (const uint32_t *) &g_stats[0];
+	const uint32_t *core1 = (const uint32_t *) &g_stats[1];
+	uint32_t *dst = (uint32_t *) &s_snapshot;
+
+	for (size_t i = 0; i < sizeof(stats_counters_t) / sizeof(uint32_t); i++)
+	{
+		dst[i] = core0[i] + core1[i];
+	}
+
+	// Maxima don't add up across cores
+#define STATS_COMBINE_MAX(field) \
+	s_snapshot.field = (g_stats[0].field > g_stats[1].field) ? g_stats[0].field : g_stats[1].field
+
+	STATS_COMBINE_MAX(worstReadUs);
+	STATS_COMBINE_MAX(longestSeek);
+	STATS_COMBINE_MAX(subqWorstLateUs);
+	STATS_COMBINE_MAX(core0WorstResponseUs);
+#undef STATS_COMBINE_MAX
+
+	s_snapshotTimeMs = to_ms_since_boot(get_absolute_time());
+}
+
+uint16_t *stats_read_sector(void)
+{
+	static uint16_t stats_buf[STATS_SECTOR_WORDS];
+
+	memset(stats_buf, 0, sizeof(stats_buf));
+
+	stats_buf[0] = 'S' | 'T' << 8;
+	stats_buf[1] = 'A' | '1' << 8;
+	stats_buf[2] = (uint16_t) sizeof(stats_counters_t);
+	stats_buf[3] = (uint16_t) s_snapshotTimeMs;
+	stats_buf[4] = (uint16_t) (s_snapshotTimeMs >> 16);
+
+	stats_buf[5] = BOOT_PHASE_COUNT;
+
+	memcpy(&stats_buf[STATS_DATA_OFFSET], &s_snapshot, sizeof(s_snapshot));
+	memcpy(&stats_buf[STATS_DATA_OFFSET + sizeof(s_snapshot) / sizeof(uint16_t)], s_bootPhaseUs, sizeof(s_bootPhaseUs));
+
+	return stats_buf;
+}
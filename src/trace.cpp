@@ -0,0 +1,138 @@
+#include "trace.h"
+
+#if TRACE_RECORDER
+
+#include <stdio.h>
+#include <string.h>
+
+#include "ff.h"
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+#include "logging.h"
+#include "pico/platform.h"
+
+#if DEBUG_FILEIO
+#define DEBUG_PRINT(...) printf(__VA_ARGS__)
+#else
+#define DEBUG_PRINT(...) while (0)
+#endif
+
+static constexpr const char *c_traceFileName = "picostation.trc";
+static constexpr size_t c_recordsPerBlock = 512 / sizeof(picostation::Trace::Record);
+
+static FIL s_traceFile;
+static picostation::Trace::Record s_writeBlock[c_recordsPerBlock];
+
+picostation::TraceRecorder picostation::g_traceRecorder;
+
+void __time_critical_func(picostation::TraceRecorder::record)(const uint8_t event, const uint8_t flags,
+                                                              const uint16_t aux, const uint32_t arg0,
+                                                              const uint32_t arg1)
+{
+    const uint32_t core = get_core_num();
+    Ring &ring = m_rings[core];
+
+    // Core0 records from both the XLAT IRQ and its main loop, so keep the slot claim atomic there
+    const uint32_t irqState = save_and_disable_interrupts();
+    const uint32_t head = ring.head;
+
+    if ((head - ring.tail) >= c_ringSize)
+    {
+        ring.dropped = ring.dropped + 1;
+        restore_interrupts(irqState);
+        return;
+    }
+
+    Trace::Record &rec = ring.records[head & (c_ringSize - 1)];
+    rec.timestamp = time_us_32();
+    rec.event = event;
+    rec.flags = flags;
+    rec.aux = aux;
+    rec.arg0 = arg0;
+    rec.arg1 = arg1;
+
+    __dmb();
+    ring.head = head + 1;
+    restore_interrupts(irqState);
+}
+
+bool picostation::TraceRecorder::openFile()
+{
+    if (m_fileOpen || m_fileFailed)
+    {
+        return m_fileOpen;
+    }
+
+    FRESULT fr = f_open(&s_traceFile, c_traceFileName, FA_WRITE | FA_CREATE_ALWAYS);
+    if (fr != FR_OK)
+    {
+        DEBUG_PRINT("trace: f_open error: (%d)\n", fr);
+        m_fileFailed = true;
+        return false;
+    }
+
+    const Trace::FileHeader header = {Trace::c_fileMagic, Trace::c_fileVersion, sizeof(Trace::Record)};
+    UINT bw;
+    f_write(&s_traceFile, &header, sizeof(header), &bw);
+    m_fileOpen = true;
+    return true;
+}
+
+void picostation::TraceRecorder::drain(Ring &ring, const uint16_t core)
+{
+    size_t count = 0;
+
+    const uint32_t dropped = ring.dropped;
+    if (dropped)
+    {
+        s_writeBlock[count++] = {time_us_32(), Trace::EVENT_DROPPED, 0, core, dropped, 0};
+        ring.dropped = 0;  // a drop racing with this reset is only under-reported
+    }
+
+    uint32_t tail = ring.tail;
+    const uint32_t head = ring.head;
+    __dmb();
+
+    while (tail != head && count < c_recordsPerBlock)
+    {
+        s_writeBlock[count++] = ring.records[tail & (c_ringSize - 1)];
+        tail++;
+    }
+
+    __dmb();
+    ring.tail = tail;
+
+    if (count)
+    {
+        UINT bw;
+        FRESULT fr = f_write(&s_traceFile, s_writeBlock, count * sizeof(Trace::Record), &bw);
+        if (fr != FR_OK)
+        {
+            DEBUG_PRINT("trace: f_write error: (%d)\n", fr);
+        }
+    }
+}
+
+void picostation::TraceRecorder::flush(const bool driveIdle)
+{
+    // Bounded to one SD block per ring, so a flush never holds core1 for long. Outside a real idle only a
+    // ring about to drop records is written, the SD card would otherwise add to the seeks being traced.
+    bool pending = false;
+    bool nearlyFull = false;
+    for (const Ring &ring : m_rings)
+    {
+        pending |= (ring.head != ring.tail) || ring.dropped;
+        nearlyFull |= (ring.head - ring.tail) >= c_ringSize * 3 / 4 || ring.dropped;
+    }
+
+    if (!pending || !(driveIdle || nearlyFull) || !openFile())
+    {
+        return;
+    }
+
+    drain(m_rings[0], 0);
+    drain(m_rings[1], 1);
+    f_sync(&s_traceFile);
+}
+
+#endif
@@ -8,6 +8,7 @@
 #include "ff.h"			/* Obtains integer types */
 #include "diskio.h"		/* Declarations of disk functions */
 #include "picostation_pinout.h"
+#include "stats.h"
 
 #define MAX_RETRIES     500000
 #define READ_RETRIES    50000
@@ -397,6 +398,7 @@ int __not_in_flash_func(sd_read_blocks)(uint32_t block, size_t count, uint8_t *b
         }
         
 		if(wait_nbsy()) {
+			STATS_INC(sdTokenTimeouts);
 			rv = -1;
             goto out;
 		}
@@ -418,6 +420,7 @@ int __not_in_flash_func(sd_read_blocks)(uint32_t block, size_t count, uint8_t *b
         
         while(count--) {
 			if(wait_nbsy()) {
+				STATS_INC(sdTokenTimeouts);
 				rv = -1;
 				goto out;
 			}
@@ -589,6 +592,7 @@ DRESULT __not_in_flash_func(disk_read)( BYTE *buff,     /* Data buffer to store
 )
 {
     if(sd_read_blocks(sector, count, buff, sc, dt)) {
+		STATS_INC(sdErrors);
 		return RES_ERROR;
 	}
     
@@ -0,0 +1,317 @@
+// Replays a recorded trace (TRACE_RECORDER=ON) through the firmware sector cache (include/sector_cache.h)
+// for a range of cache sizes, replacement policies and read-ahead depths, against a simple SD latency model.
+//
+// usage: cache_sim <picostation.trc> [options]
+//   --slots 4,8,16,32        cache sizes to try (power of 2, max 64)
+//   --ahead 0,1,2,4,8        read-ahead depths to try
+//   --random-us 1500         SD latency of a non-sequential sector read
+//   --seq-us 900             SD latency of the sector following the previous read
+//   --stall-permille 2       chance of an SD housekeeping stall per read
+//   --stall-us 40000         length of a stall
+//   --trace-latency          draw read latencies from the misses recorded in the trace instead
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <deque>
+#include <vector>
+
+#include "sector_cache.h"
+#include "trace.h"
+#include "trace_file.h"
+
+using namespace picostation;
+
+namespace {
+
+constexpr int c_leadIn = 4500;
+constexpr int c_preGap = 150;
+constexpr size_t c_maxSlots = 64;
+constexpr uint64_t c_sectorPeriodUs = 1000000 / 75;
+
+using Cache = SectorCache<c_maxSlots>;
+
+struct Request {
+    uint64_t time;  // us, when the firmware asked for the sector
+    int sector;
+    int speed;
+};
+
+struct SdModel {
+    uint32_t randomUs = 1500;
+    uint32_t sequentialUs = 900;
+    uint32_t stallPermille = 2;
+    uint32_t stallUs = 40000;
+    std::vector<uint32_t> recorded;  // used instead of the fixed model when not empty
+
+    uint32_t rng = 1;
+
+    uint32_t next()
+    {
+        rng = rng * 1103515245u + 12345u;
+        return rng >> 8;
+    }
+
+    uint32_t latency(const int sector, const int previousSector)
+    {
+        if (!recorded.empty())
+        {
+            return recorded[next() % recorded.size()];
+        }
+
+        uint32_t us = (sector == previousSector + 1) ? sequentialUs : randomUs;
+        if ((next() % 1000) < stallPermille)
+        {
+            us += stallUs;
+        }
+        return us;
+    }
+};
+
+struct Candidate {
+    size_t slots;
+    Cache::Replacement replacement;
+    uint32_t readAhead;
+};
+
+struct Result {
+    uint32_t hits = 0;
+    uint32_t misses = 0;
+    uint32_t deadlineMisses = 0;
+    uint32_t prefetchReads = 0;
+    uint64_t sdBytes = 0;
+    uint64_t worstWaitUs = 0;
+};
+
+const char *replacementName(const Cache::Replacement replacement)
+{
+    switch (replacement)
+    {
+        case Cache::Replacement::NEXT_FREE: return "firmware";
+        case Cache::Replacement::FIFO: return "fifo";
+        case Cache::Replacement::LRU: return "lru";
+    }
+    return "?";
+}
+
+// Bytes the SD card transfers for one 2352 byte sector of a .bin image
+uint64_t sdBytesForSector(const int sector)
+{
+    const int64_t lba = sector - c_leadIn - c_preGap;
+    if (lba < 0)
+    {
+        return 0;
+    }
+
+    const uint64_t first = (uint64_t)lba * 2352;
+    const uint64_t last = first + 2352 - 1;
+    return ((last / 512) - (first / 512) + 1) * 512;
+}
+
+std::vector<Request> extractRequests(const std::vector<Trace::Record> &records)
+{
+    std::vector<Request> requests;
+    uint64_t epoch = 0;
+    uint32_t last = records.empty() ? 0 : records[0].timestamp;
+    int speed = 1;
+
+    for (const Trace::Record &rec : records)
+    {
+        if (rec.timestamp < last && (last - rec.timestamp) > 0x80000000u)
+        {
+            epoch += 1ull << 32;
+        }
+        last = rec.timestamp;
+
+        if (rec.event == Trace::EVENT_MECH_COMMAND && ((rec.arg0 >> 20) & 0xF) == 0x9)
+        {
+            speed = ((rec.arg0 >> 18) & 1) + 1;  // FUNCTION_SPECIFICATION DSPB
+        }
+        else if (rec.event == Trace::EVENT_SECTOR_REQUEST)
+        {
+            // Records are stamped once the sector was loaded; arg1 holds the read time
+            requests.push_back({(epoch | rec.timestamp) - rec.arg1, (int)rec.arg0, speed});
+        }
+    }
+
+    std::stable_sort(requests.begin(), requests.end(),
+                     [](const Request &a, const Request &b) { return a.time < b.time; });
+    return requests;
+}
+
+Result simulate(const std::vector<Request> &requests, const Candidate &candidate, SdModel sd)
+{
+    Result result;
+    Cache cache;
+    cache.setCapacity(candidate.slots);
+    cache.setReplacement(candidate.replacement);
+
+    uint64_t readyAt[c_maxSlots] = {0};
+    uint64_t sdFreeAt = 0;
+    int sdLastSector = -1;
+    size_t busySlot = 1;
+    std::deque<int> prefetch;
+
+    auto load = [&](const int sector, const uint64_t start) -> size_t {
+        const uint64_t begin = std::max(start, sdFreeAt);
+        sdFreeAt = begin + sd.latency(sector, sdLastSector);
+        sdLastSector = sector;
+        result.sdBytes += sdBytesForSector(sector);
+
+        const size_t slot = cache.allocate(busySlot);
+        cache.assign(slot, sector);
+        readyAt[slot] = sdFreeAt;
+        return slot;
+    };
+
+    for (const Request &req : requests)
+    {
+        // Read-ahead runs whenever the card is idle before the next request; a read that is
+        // already in flight can't be interrupted
+        while (!prefetch.empty() && sdFreeAt < req.time)
+        {
+            const int sector = prefetch.front();
+            prefetch.pop_front();
+            if (cache.find(sector) < 0)
+            {
+                load(sector, sdFreeAt);
+                result.prefetchReads++;
+            }
+        }
+
+        int slot = cache.find(req.sector);
+        uint64_t ready;
+        if (slot >= 0)
+        {
+            result.hits++;
+            ready = std::max(req.time, readyAt[slot]);
+        }
+        else
+        {
+            result.misses++;
+            slot = load(req.sector, req.time);
+            ready = readyAt[slot];
+        }
+
+        const uint64_t wait = ready - req.time;
+        result.worstWaitUs = std::max(result.worstWaitUs, wait);
+        if (wait > c_sectorPeriodUs / req.speed)
+        {
+            result.deadlineMisses++;
+        }
+
+        busySlot = slot;
+        prefetch.clear();
+        for (uint32_t i = 1; i <= candidate.readAhead; i++)
+        {
+            prefetch.push_back(req.sector + i);
+        }
+    }
+
+    return result;
+}
+
+std::vector<uint32_t> parseList(const char *arg)
+{
+    std::vector<uint32_t> values;
+    while (*arg)
+    {
+        values.push_back(strtoul(arg, const_cast<char **>(&arg), 10));
+        if (*arg == ',')
+        {
+            arg++;
+        }
+        else if (*arg)
+        {
+            break;
+        }
+    }
+    return values;
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s <picostation.trc> [--slots 4,8,16,32] [--ahead 0,1,2,4,8] [--random-us N]\n"
+                        "       [--seq-us N] [--stall-permille N] [--stall-us N] [--trace-latency]\n",
+                argv[0]);
+        return 1;
+    }
+
+    std::vector<uint32_t> slotCounts = {4, 8, 16, 32};
+    std::vector<uint32_t> readAheads = {0, 1, 2, 4, 8};
+    SdModel sd;
+    bool traceLatency = false;
+
+    for (int i = 2; i < argc; i++)
+    {
+        const bool hasValue = (i + 1) < argc;
+        if (!strcmp(argv[i], "--slots") && hasValue) slotCounts = parseList(argv[++i]);
+        else if (!strcmp(argv[i], "--ahead") && hasValue) readAheads = parseList(argv[++i]);
+        else if (!strcmp(argv[i], "--random-us") && hasValue) sd.randomUs = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seq-us") && hasValue) sd.sequentialUs = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--stall-permille") && hasValue) sd.stallPermille = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--stall-us") && hasValue) sd.stallUs = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--trace-latency")) traceLatency = true;
+        else
+        {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    std::vector<Trace::Record> records;
+    if (!readTrace(argv[1], records))
+    {
+        return 1;
+    }
+
+    if (traceLatency)
+    {
+        for (const Trace::Record &rec : records)
+        {
+            if (rec.event == Trace::EVENT_SECTOR_REQUEST && !(rec.flags & Trace::FLAG_CACHE_HIT))
+            {
+                sd.recorded.push_back(rec.arg1);
+            }
+        }
+        if (sd.recorded.empty())
+        {
+            fprintf(stderr, "no recorded misses, using the fixed latency model\n");
+        }
+    }
+
+    const std::vector<Request> requests = extractRequests(records);
+    printf("%zu sector requests\n\n", requests.size());
+    printf("slots  policy    ahead   hit%%  deadline-miss  worst-wait-us    sd-KiB  prefetches\n");
+
+    for (const uint32_t slots : slotCounts)
+    {
+        if (slots < 2 || slots > c_maxSlots || (slots & (slots - 1)))
+        {
+            fprintf(stderr, "skipping %u slots: must be a power of 2 between 2 and %zu\n", slots, c_maxSlots);
+            continue;
+        }
+
+        for (const Cache::Replacement replacement :
+             {Cache::Replacement::NEXT_FREE, Cache::Replacement::FIFO, Cache::Replacement::LRU})
+        {
+            for (const uint32_t readAhead : readAheads)
+            {
+                const Result r = simulate(requests, {slots, replacement, readAhead}, sd);
+                const uint32_t total = r.hits + r.misses;
+                printf("%5u  %-8s  %5u  %5.1f  %13u  %13llu  %8llu  %10u\n", slots, replacementName(replacement),
+                       readAhead, total ? 100.0 * r.hits / total : 0.0, r.deadlineMisses,
+                       (unsigned long long)r.worstWaitUs, (unsigned long long)(r.sdBytes / 1024), r.prefetchReads);
+            }
+        }
+    }
+
+    return 0;
+}
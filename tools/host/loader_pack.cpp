@@ -0,0 +1,222 @@
+// Packs the menu loader (binary/picostation-menu.bin) into the sector indexed LZ4 image the firmware embeds
+// with LOADER_COMPRESSED=ON (see include/loader_stream.h), then decodes every sector back with the firmware
+// decoder to check it.
+//
+// usage: loader_pack <picostation-menu.bin> <out> [--bench]
+//   --bench    also time decoding every sector against copying it, on this machine (not XIP, see LOADER_BENCHMARK)
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>
+#include <vector>
+
+#include "loader_stream.h"
+#include "lz4_block.h"
+
+using namespace picostation;
+
+namespace {
+
+constexpr size_t c_sectorBytes = LoaderStream::c_sectorBytes;
+constexpr size_t c_hashBits = 12;
+constexpr size_t c_minMatch = 4;
+constexpr size_t c_lastLiterals = 5;   // the format wants the block to end in at least this many literals
+constexpr size_t c_matchFromEnd = 12;  // and no match to start closer than this to the end
+
+uint32_t read32(const uint8_t *p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+void putLength(std::vector<uint8_t> &out, size_t length)
+{
+    for (; length >= 255; length -= 255)
+    {
+        out.push_back(255);
+    }
+    out.push_back((uint8_t)length);
+}
+
+void putSequence(std::vector<uint8_t> &out, const uint8_t *literals, const size_t literalCount, const size_t offset,
+                 const size_t matchLength)
+{
+    const size_t matchCode = matchLength ? matchLength - c_minMatch : 0;
+    out.push_back((uint8_t)((literalCount < 15 ? literalCount : 15) << 4 | (matchCode < 15 ? matchCode : 15)));
+    if (literalCount >= 15)
+    {
+        putLength(out, literalCount - 15);
+    }
+    out.insert(out.end(), literals, literals + literalCount);
+    if (!matchLength)
+    {
+        return;
+    }
+    out.push_back((uint8_t)offset);
+    out.push_back((uint8_t)(offset >> 8));
+    if (matchCode >= 15)
+    {
+        putLength(out, matchCode - 15);
+    }
+}
+
+// Greedy, one candidate per hash. Sectors are small and compressed once, the decoder is what has to be fast.
+std::vector<uint8_t> compress(const uint8_t *src, const size_t size)
+{
+    std::vector<uint8_t> out;
+    std::vector<int> table(1 << c_hashBits, -1);
+    size_t anchor = 0;
+    size_t pos = 0;
+
+    while (size > c_matchFromEnd && pos < size - c_matchFromEnd)
+    {
+        const uint32_t sequence = read32(src + pos);
+        const size_t hash = (sequence * 2654435761u) >> (32 - c_hashBits);
+        const int candidate = table[hash];
+        table[hash] = (int)pos;
+
+        if (candidate < 0 || pos - candidate > 65535 || read32(src + candidate) != sequence)
+        {
+            pos++;
+            continue;
+        }
+
+        size_t length = c_minMatch;
+        while (pos + length < size - c_lastLiterals && src[candidate + length] == src[pos + length])
+        {
+            length++;
+        }
+        putSequence(out, src + anchor, pos - anchor, pos - candidate, length);
+        pos += length;
+        anchor = pos;
+    }
+
+    putSequence(out, src + anchor, size - anchor, 0, 0);
+    return out;
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "usage: %s <picostation-menu.bin> <out> [--bench]\n", argv[0]);
+        return 1;
+    }
+    const bool bench = argc > 3 && strcmp(argv[3], "--bench") == 0;
+
+    FILE *fp = fopen(argv[1], "rb");
+    if (!fp)
+    {
+        perror(argv[1]);
+        return 1;
+    }
+    std::vector<uint8_t> image;
+    uint8_t chunk[4096];
+    for (size_t got; (got = fread(chunk, 1, sizeof(chunk), fp)) > 0;)
+    {
+        image.insert(image.end(), chunk, chunk + got);
+    }
+    fclose(fp);
+
+    // Same as the uncompressed image, a partial last sector is never read
+    const uint32_t sectorCount = image.size() / c_sectorBytes;
+    if (image.size() % c_sectorBytes)
+    {
+        fprintf(stderr, "%s: %zu trailing bytes dropped\n", argv[1], image.size() % c_sectorBytes);
+    }
+
+    std::vector<uint32_t> offsets;
+    std::vector<uint8_t> blocks;
+    const size_t headerBytes = sizeof(LoaderStream::PackedHeader) + (sectorCount + 1) * sizeof(uint32_t);
+    uint32_t storedRaw = 0;
+    for (uint32_t i = 0; i < sectorCount; i++)
+    {
+        const uint8_t *sector = &image[i * c_sectorBytes];
+        std::vector<uint8_t> block = compress(sector, c_sectorBytes);
+        block.resize((block.size() + 3) & ~3u);
+        // A block the size of a sector means stored as is
+        if (block.size() >= c_sectorBytes)
+        {
+            block.assign(sector, sector + c_sectorBytes);
+            storedRaw++;
+        }
+        offsets.push_back(headerBytes + blocks.size());
+        blocks.insert(blocks.end(), block.begin(), block.end());
+    }
+    offsets.push_back(headerBytes + blocks.size());
+
+    std::vector<uint8_t> packed(headerBytes);
+    const LoaderStream::PackedHeader header = {LoaderStream::PackedHeader::c_magic, sectorCount};
+    memcpy(&packed[0], &header, sizeof(header));
+    memcpy(&packed[sizeof(header)], offsets.data(), offsets.size() * sizeof(uint32_t));
+    packed.insert(packed.end(), blocks.begin(), blocks.end());
+
+    // Check every sector the way the firmware reads it
+    uint8_t decoded[c_sectorBytes];
+    for (uint32_t i = 0; i < sectorCount; i++)
+    {
+        const uint32_t size = offsets[i + 1] - offsets[i];
+        const uint8_t *block = &packed[offsets[i]];
+        const bool ok = (size == c_sectorBytes) ? (memcpy(decoded, block, size), true)
+                                                : lz4_decode_block(block, size, decoded, c_sectorBytes);
+        if (!ok || memcmp(decoded, &image[i * c_sectorBytes], c_sectorBytes) != 0)
+        {
+            fprintf(stderr, "sector %u doesn't decode back\n", i);
+            return 1;
+        }
+    }
+
+    fp = fopen(argv[2], "wb");
+    if (!fp)
+    {
+        perror(argv[2]);
+        return 1;
+    }
+    const bool written = fwrite(packed.data(), 1, packed.size(), fp) == packed.size();
+    if (fclose(fp) != 0 || !written)
+    {
+        perror(argv[2]);
+        return 1;
+    }
+
+    printf("%u sectors, %zu -> %zu bytes (%.1f%%), %u stored uncompressed\n", sectorCount,
+           (size_t)sectorCount * c_sectorBytes, packed.size(), 100.0 * packed.size() / (sectorCount * c_sectorBytes),
+           storedRaw);
+
+    if (bench)
+    {
+        constexpr int c_rounds = 200;
+        uint32_t sink = 0;
+        const auto timeRounds = [&](const bool decode) {
+            const auto start = std::chrono::steady_clock::now();
+            for (int round = 0; round < c_rounds; round++)
+            {
+                for (uint32_t i = 0; i < sectorCount; i++)
+                {
+                    const uint32_t size = offsets[i + 1] - offsets[i];
+                    if (decode && size != c_sectorBytes)
+                    {
+                        lz4_decode_block(&packed[offsets[i]], size, decoded, c_sectorBytes);
+                    }
+                    else
+                    {
+                        memcpy(decoded, &image[i * c_sectorBytes], c_sectorBytes);
+                    }
+                    sink += decoded[i % c_sectorBytes];
+                }
+            }
+            const auto elapsed = std::chrono::steady_clock::now() - start;
+            return std::chrono::duration<double, std::micro>(elapsed).count() / (c_rounds * (double)sectorCount);
+        };
+        const double copyUs = timeRounds(false);
+        const double decodeUs = timeRounds(true);
+        printf("per sector: decode %.2fus, copy %.2fus (%u)\n", decodeUs, copyUs, sink & 1);
+        printf("against XIP on the RP2040: build with -DLOADER_BENCHMARK=ON, see loaderBenchDecodeUs/loaderBenchXipUs\n");
+    }
+    return 0;
+}
@@ -0,0 +1,434 @@
+// Runs the real mechacon command handling (src/cmd.cpp) and drive mechanics (src/drive_mechanics.cpp)
+// on the host against a simplified model of the console's CD controller. Each scenario seeks from one
+// sector to another the way ReadN/Play do, and reports how long the seek took to settle on a SubQ
+// position, how long until the requested sector was delivered, and how long a GetlocP then waits for
+// fresh SubQ. Time is virtual (tools/host/sim/sim_hal.cpp), so results are exact and repeatable.
+//
+// usage: mech_sim [--read-us N] [from:to[:speed] ...]
+//   from/to are absolute sectors (lead-in included), speed is 1 or 2. Without scenarios a default set runs.
+//   Exits with 1 if any scenario fails to reach its target.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "cmd.h"
+#include "disc_image.h"
+#include "drive_mechanics.h"
+#include "i2s.h"
+#include "pico/time.h"
+#include "picostation.h"
+#include "sim_hal.h"
+#include "stats.h"
+#include "values.h"
+
+// Globals the simulated sources link against, normally owned by main.cpp, picostation.cpp and i2s.cpp
+picostation::I2S m_i2s;
+picostation::DiscImage picostation::g_discImage;
+picostation::SpscQueue<picostation::MenuCommand, 8> picostation::g_menuCommands;
+pseudoatomic<uint32_t> picostation::g_menuCommandsLatched;
+pseudoatomic<uint32_t> picostation::g_menuCommandsQueued;
+int picostation::g_targetPlaybackSpeed = 1;
+unsigned int picostation::g_soctOffset = 0;
+int c_sectorMax = c_leadIn + c_preGap + 333000;  // 74 minute disc
+
+namespace {
+
+constexpr uint64_t c_tickUs = 5;              // one pass of the core0 loop
+constexpr uint64_t c_commandUs = 25;          // 24 bit mechacon write
+constexpr uint64_t c_subqTimeoutUs = 200000;
+constexpr uint64_t c_seekTimeoutUs = 5000000;
+constexpr uint32_t c_sledMinTracks = 512;     // COUT only toggles every 256 tracks, see DriveMechanics::sledWrap
+constexpr int c_maxSeekSteps = 32;
+
+// Mechacon command words, see MechCommand::mech_cmd
+constexpr uint32_t c_cmdTrackingMode = 0x2 << 20;
+constexpr uint32_t c_cmdAutoSequence = 0x4 << 20;
+constexpr uint32_t c_cmdTrackCount = 0x7 << 20;
+constexpr uint32_t c_cmdFunctionSpec = 0x9 << 20;
+constexpr uint32_t c_cmdClvMode = 0xE << 20;
+
+constexpr uint32_t c_sledForward = 0x2 << 16;
+constexpr uint32_t c_sledReverse = 0x3 << 16;
+constexpr uint32_t c_aseqFocusOn = 0x3 << 17;
+constexpr uint32_t c_aseq1Track = 0x4 << 17;
+constexpr uint32_t c_aseq2NTrack = 0x6 << 17;
+constexpr uint32_t c_aseqReverse = 1 << 16;
+constexpr uint32_t c_functionSpecDSPB = 1 << 18;
+constexpr uint32_t c_clvModeCLVA = 0x6 << 16;
+
+// What core0Entry and I2S::start do to pace sectors and SubQ, minus the data itself
+class Drive {
+  public:
+    explicit Drive(picostation::MechCommand &mech) : m_mech(mech) {}
+
+    void setReadUs(const uint64_t us) { m_readUs = us; }
+
+    void tick()
+    {
+        // COUT comes from the sled timer's IRQ
+        if (!picostation::g_driveMechanics.isSledStopped())
+        {
+            m_streaming = false;
+            return;
+        }
+
+        if (!m_i2s.isStreaming())
+        {
+            m_streaming = false;
+            return;
+        }
+
+        const uint64_t now = sim::now();
+        if (!m_streaming)
+        {
+            // core1 has to load the sector before the DMA can start
+            m_streaming = true;
+            m_nextDma = now + m_readUs;
+            return;
+        }
+
+        if (now < m_nextDma)
+        {
+            return;
+        }
+
+        const int sector = picostation::g_driveMechanics.getSector();
+        m_deliveredSector = sector;
+        m_deliveredTime = now;
+        m_nextDma += c_sectorPeriodUs / picostation::g_targetPlaybackSpeed;
+
+        if (m_mech.getSens(SENS::GFS))
+        {
+            picostation::g_driveMechanics.moveToNextSector();
+            m_pendingSubQ = sector;
+            add_alarm_in_us(c_MaxSubqDelayTime, &Drive::subqAlarm, this, true);
+        }
+    }
+
+    int deliveredSector() const { return m_deliveredSector; }
+    uint64_t deliveredTime() const { return m_deliveredTime; }
+    int subqSector() const { return m_subqSector; }
+    uint32_t subqCount() const { return m_subqCount; }
+
+  private:
+    static int64_t subqAlarm(alarm_id_t id, void *user_data)
+    {
+        static_cast<Drive *>(user_data)->sendSubQ();
+        return 0;
+    }
+
+    // Same gate as SubQ::start_subq
+    void sendSubQ()
+    {
+        if (!picostation::g_driveMechanics.isSledStopped() || picostation::g_driveMechanics.req_skip_subq())
+        {
+            picostation::g_driveMechanics.clear_skip_subq();
+            return;
+        }
+
+        m_subqSector = m_pendingSubQ;
+        m_subqCount++;
+    }
+
+    picostation::MechCommand &m_mech;
+    uint64_t m_readUs = 1500;
+    bool m_streaming = false;
+    uint64_t m_nextDma = 0;
+    int m_deliveredSector = -1;
+    uint64_t m_deliveredTime = 0;
+    int m_pendingSubQ = -1;
+    int m_subqSector = -1;
+    uint32_t m_subqCount = 0;
+};
+
+struct SeekResult {
+    bool ok = false;
+    const char *error = "";
+    int steps = 0;
+    uint64_t settleUs = 0;
+    uint64_t firstDataUs = 0;
+    uint64_t getlocUs = 0;
+};
+
+// Rough model of the console's CD controller: closed loop on SubQ position with sled moves for long
+// distances, 2N track jumps for medium ones and single track jumps to finish
+class Console {
+  public:
+    Console(picostation::MechCommand &mech, Drive &drive) : m_mech(mech), m_drive(drive) {}
+
+    void write(const uint32_t raw)
+    {
+        for (int shift = 0; shift < 24; shift += 8)
+        {
+            sim::pushRx(PIOInstance::MECHACON, SM::MECHACON, ((raw >> shift) & 0xFF) << 24);
+        }
+        run(c_commandUs);
+        m_mech.updateMech();  // XLAT IRQ
+        m_mech.processLatchedCommand();
+        m_mech.processDeferredCommands();  // core0 loop
+    }
+
+    // Selects a SENS address with a single byte, no latch. The state machine then drives SENS from the
+    // mask, which is what the console reads
+    bool sens(const unsigned int address)
+    {
+        sim::pushRx(PIOInstance::MECHACON, SM::MECHACON, (address << 4) << 24);
+        m_mech.updateMech();
+        return m_mech.getSens(address);
+    }
+
+    void run(const uint64_t us)
+    {
+        for (uint64_t t = 0; t < us; t += c_tickUs)
+        {
+            sim::advance(c_tickUs);
+            m_drive.tick();
+        }
+    }
+
+    bool waitFor(const std::function<bool()> &done, const uint64_t timeoutUs)
+    {
+        const uint64_t deadline = sim::now() + timeoutUs;
+        while (!done())
+        {
+            if (sim::now() >= deadline)
+            {
+                return false;
+            }
+            run(c_tickUs);
+        }
+        return true;
+    }
+
+    int readSubQ()
+    {
+        const uint32_t count = m_drive.subqCount();
+        if (!waitFor([&] { return m_drive.subqCount() != count; }, c_subqTimeoutUs))
+        {
+            return -1;
+        }
+        return m_drive.subqSector();
+    }
+
+    bool spinUp()
+    {
+        if (sens(SENS::FOK))
+        {
+            return true;
+        }
+
+        write(c_cmdAutoSequence | c_aseqFocusOn);
+        return waitFor([&] { return !sens(SENS::XBUSY); }, c_subqTimeoutUs);
+    }
+
+    void setSpeed(const int speed) { write(c_cmdFunctionSpec | ((speed == 2) ? c_functionSpecDSPB : 0)); }
+
+    SeekResult seek(const int target)
+    {
+        SeekResult result;
+        const uint64_t start = sim::now();
+
+        if (!spinUp())
+        {
+            result.error = "no focus";
+            return result;
+        }
+        write(c_cmdClvMode | c_clvModeCLVA);
+
+        // Aim up to a track before the target and read into it
+        const int window = picostation::DriveMechanics::sectorsPerTrack(target);
+        while (true)
+        {
+            const int position = readSubQ();
+            if (position < 0)
+            {
+                result.error = "no SubQ";
+                return result;
+            }
+
+            if (position < target && position >= target - window)
+            {
+                break;
+            }
+
+            if (++result.steps > c_maxSeekSteps || (sim::now() - start) > c_seekTimeoutUs)
+            {
+                result.error = "seek did not converge";
+                return result;
+            }
+
+            const int aim = target - window / 2;
+            const bool reverse = aim < position;
+            uint32_t tracks = reverse ? tracksBetween(aim, position) : tracksBetween(position, aim);
+            tracks = std::max<uint32_t>(tracks, 1);
+
+            if (tracks >= c_sledMinTracks)
+            {
+                if (!moveSled(tracks, reverse))
+                {
+                    result.error = "COUT never toggled";
+                    return result;
+                }
+            }
+            else if (tracks >= 2)
+            {
+                write(c_cmdTrackCount | ((tracks / 2) << 4));
+                write(c_cmdAutoSequence | c_aseq2NTrack | (reverse ? c_aseqReverse : 0));
+            }
+            else
+            {
+                write(c_cmdAutoSequence | c_aseq1Track | (reverse ? c_aseqReverse : 0));
+            }
+
+            write(c_cmdClvMode | c_clvModeCLVA);
+        }
+        result.settleUs = sim::now() - start;
+
+        if (!waitFor([&] { return m_drive.deliveredSector() >= target; }, c_seekTimeoutUs))
+        {
+            result.error = "target never delivered";
+            return result;
+        }
+        if (m_drive.deliveredSector() != target)
+        {
+            result.error = "target skipped";
+            return result;
+        }
+        result.firstDataUs = m_drive.deliveredTime() - start;
+
+        const uint64_t getloc = sim::now();
+        if (readSubQ() < 0)
+        {
+            result.error = "no SubQ after reading";
+            return result;
+        }
+        result.getlocUs = sim::now() - getloc;
+
+        result.ok = true;
+        return result;
+    }
+
+  private:
+    static uint32_t tracksBetween(const uint32_t from, const uint32_t to)
+    {
+        return picostation::DriveMechanics::sectorToTrack(to) - picostation::DriveMechanics::sectorToTrack(from);
+    }
+
+    bool moveSled(const uint32_t tracks, const bool reverse)
+    {
+        write(c_cmdTrackingMode | (reverse ? c_sledReverse : c_sledForward));
+
+        bool cout = sens(SENS::COUT);
+        for (uint32_t counted = 256; counted <= tracks; counted += 256)
+        {
+            if (!waitFor([&] { return sens(SENS::COUT) != cout; }, c_subqTimeoutUs))
+            {
+                return false;
+            }
+            cout = !cout;
+        }
+
+        write(c_cmdTrackingMode);
+        return true;
+    }
+
+    picostation::MechCommand &m_mech;
+    Drive &m_drive;
+};
+
+struct Scenario {
+    std::string name;
+    int from;
+    int to;
+    int speed;
+};
+
+bool parseScenario(const char *arg, Scenario &scenario)
+{
+    int from, to, speed = 2;
+    if (sscanf(arg, "%d:%d:%d", &from, &to, &speed) < 2 || (speed != 1 && speed != 2))
+    {
+        return false;
+    }
+    scenario = {arg, from, to, speed};
+    return true;
+}
+
+double ms(const uint64_t us) { return us / 1000.0; }
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    uint64_t readUs = 1500;
+    std::vector<Scenario> scenarios;
+
+    for (int i = 1; i < argc; i++)
+    {
+        Scenario scenario;
+        if (!strcmp(argv[i], "--read-us") && (i + 1) < argc)
+        {
+            readUs = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (parseScenario(argv[i], scenario))
+        {
+            scenarios.push_back(scenario);
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--read-us N] [from:to[:speed] ...]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (scenarios.empty())
+    {
+        const int start = c_leadIn + c_preGap;
+        scenarios = {
+            {"ReadN next file", start + 20000, start + 20300, 2},
+            {"ReadN same track", start + 50000, start + 50012, 2},
+            {"ReadN backwards", start + 150000, start + 149000, 2},
+            {"ReadN far forward", start + 16, start + 280000, 2},
+            {"ReadN far backward", start + 300000, start + 16, 2},
+            {"Play audio track", start + 200000, start + 230000, 1},
+        };
+    }
+
+    printf("%-20s %8s %8s %5s %5s %10s %12s %10s %6s %10s  %s\n", "scenario", "from", "to", "speed", "steps",
+           "settle-ms", "first-data-ms", "getloc-ms", "seeks", "seek-sects", "result");
+
+    picostation::g_driveMechanics.init();
+
+    bool allOk = true;
+    for (const Scenario &scenario : scenarios)
+    {
+        sim::reset();
+        picostation::g_driveMechanics.resetDrive();
+
+        picostation::MechCommand mech;
+        picostation::g_driveMechanics.initSledTimer(0, mech);
+        Drive drive(mech);
+        drive.setReadUs(readUs);
+        Console console(mech, drive);
+
+        // Get to the starting point first, untimed
+        console.setSpeed(scenario.speed);
+        const SeekResult setup = console.seek(scenario.from);
+
+        stats_reset();
+        const SeekResult r = setup.ok ? console.seek(scenario.to) : setup;
+        allOk &= r.ok;
+
+        printf("%-20s %8d %8d %5d %5d %10.1f %12.1f %10.1f %6u %10u  %s%s\n", scenario.name.c_str(), scenario.from,
+               scenario.to, scenario.speed, r.steps, ms(r.settleUs), ms(r.firstDataUs), ms(r.getlocUs),
+               g_stats[0].seeks, g_stats[0].seekSectors, r.ok ? "ok" : "FAIL: ", r.error);
+    }
+
+    return allOk ? 0 : 1;
+}
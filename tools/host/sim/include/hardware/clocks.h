@@ -0,0 +1,16 @@
+#pragma once
+
+#include "pico.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum clock_index { clk_sys = 5 };
+
+// The firmware's set_sys_clock_khz(271200)
+static inline uint32_t clock_get_hz(enum clock_index clk) { return 271200000; }
+
+#ifdef __cplusplus
+}
+#endif
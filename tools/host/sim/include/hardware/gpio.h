@@ -0,0 +1,14 @@
+#pragma once
+
+#include "pico.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void gpio_put(uint gpio, bool value);
+bool gpio_get(uint gpio);
+
+#ifdef __cplusplus
+}
+#endif
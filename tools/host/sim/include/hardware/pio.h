@@ -0,0 +1,34 @@
+#pragma once
+
+#include "hardware/gpio.h"
+#include "pico.h"
+#include "pico/time.h"  // pulled in through pico/sync.h on target
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct sim_pio sim_pio_t;
+typedef sim_pio_t *PIO;
+
+extern PIO const g_simPio[2];
+#define pio0 (g_simPio[0])
+#define pio1 (g_simPio[1])
+
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled);
+void pio_sm_put_blocking(PIO pio, uint sm, uint32_t data);
+uint32_t pio_sm_get_blocking(PIO pio, uint sm);
+uint pio_sm_get_rx_fifo_level(PIO pio, uint sm);
+void pio_sm_clear_fifos(PIO pio, uint sm);
+void pio_sm_drain_tx_fifo(PIO pio, uint sm);
+void pio_interrupt_clear(PIO pio, uint irq);
+bool pio_sm_is_rx_fifo_empty(PIO pio, uint sm);
+void pio_sm_exec(PIO pio, uint sm, uint instr);
+
+enum pio_src_dest { pio_pins = 0u };
+
+static inline uint pio_encode_set(enum pio_src_dest dest, uint value) { return 0xE000u | (dest << 5) | value; }
+
+#ifdef __cplusplus
+}
+#endif
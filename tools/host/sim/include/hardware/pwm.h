@@ -0,0 +1,35 @@
+#pragma once
+
+#include "pico.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct
+{
+	uint32_t csr;
+	uint32_t div;
+	uint32_t top;
+} pwm_config;
+
+enum pwm_clkdiv_mode { PWM_DIV_FREE_RUNNING = 0 };
+
+// Counters run off the virtual clock at clock_get_hz(clk_sys); a wrap sets the slice's IRQ bit and calls the
+// PWM_IRQ_WRAP handler when it is enabled
+static inline pwm_config pwm_get_default_config(void) { return (pwm_config){0, 1, 0xFFFF}; }
+static inline void pwm_config_set_clkdiv_mode(pwm_config *c, enum pwm_clkdiv_mode mode) { c->csr = mode; }
+static inline void pwm_config_set_clkdiv_int(pwm_config *c, uint div) { c->div = div; }
+static inline void pwm_config_set_wrap(pwm_config *c, uint16_t wrap) { c->top = wrap; }
+
+void pwm_init(uint slice_num, pwm_config *c, bool start);
+void pwm_set_enabled(uint slice_num, bool enabled);
+uint16_t pwm_get_counter(uint slice_num);
+void pwm_set_counter(uint slice_num, uint16_t count);
+void pwm_set_irq_enabled(uint slice_num, bool enabled);
+void pwm_clear_irq(uint slice_num);
+uint32_t pwm_get_irq_status_mask(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+
+inline void __dmb() { std::atomic_thread_fence(std::memory_order_seq_cst); }
+inline void __sev() {}
+inline uint32_t save_and_disable_interrupts() { return 0; }
+inline void restore_interrupts(uint32_t) {}
+
+// Only one thread runs in the simulation, so a spinlock is never contended
+typedef volatile uint32_t spin_lock_t;
+
+inline unsigned int spin_lock_claim_unused(bool) { return 0; }
+inline spin_lock_t *spin_lock_init(unsigned int)
+{
+    static spin_lock_t lock;
+    return &lock;
+}
+inline uint32_t spin_lock_blocking(spin_lock_t *) { return 0; }
+inline void spin_unlock(spin_lock_t *, uint32_t) {}
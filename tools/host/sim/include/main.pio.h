@@ -0,0 +1,15 @@
+#pragma once
+
+// Host shim for the header generated from pio/main.pio. The state machines are not simulated,
+// the mechacon FIFO is fed directly by tools/host/sim/sim_hal.cpp.
+
+#include "hardware/pio.h"
+
+static inline void soct_program_init(PIO pio, uint8_t sm, uint8_t offset, uint8_t sqso_pin, uint8_t sqck_pin)
+{
+	(void) pio;
+	(void) sm;
+	(void) offset;
+	(void) sqso_pin;
+	(void) sqck_pin;
+}
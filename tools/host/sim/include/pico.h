@@ -0,0 +1,18 @@
+#pragma once
+
+// Host shim for the pico-sdk base header. Only what the simulated firmware sources use;
+// the behaviour behind these declarations lives in tools/host/sim/sim_hal.cpp.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef unsigned int uint;
+
+#define __time_critical_func(x) x
+#define __not_in_flash_func(x) x
+
+static inline void tight_loop_contents(void) {}
+
+// Everything simulated runs on core0
+static inline unsigned int get_core_num(void) { return 0; }
@@ -0,0 +1,9 @@
+#pragma once
+
+#include "pico.h"
+#include "pico/time.h"
+
+typedef struct
+{
+	uint32_t owner;
+} mutex_t;
@@ -0,0 +1,5 @@
+#pragma once
+
+#include "hardware/gpio.h"
+#include "pico.h"
+#include "pico/time.h"
@@ -0,0 +1,20 @@
+// Host version of src/mechacon_ring.cpp: no DMA, the bytes sim::pushRx queued are copied into the ring
+// when the firmware asks how many there are.
+
+#include "mechacon_ring.h"
+
+#include "hardware/pio.h"
+#include "values.h"
+
+picostation::MechaconRing picostation::g_mechaconRing;
+
+void picostation::MechaconRing::start() {}
+
+uint32_t picostation::MechaconRing::received()
+{
+    while (pio_sm_get_rx_fifo_level(PIOInstance::MECHACON, SM::MECHACON))
+    {
+        m_words[m_base++ & (c_size - 1)] = pio_sm_get_blocking(PIOInstance::MECHACON, SM::MECHACON);
+    }
+    return m_base;
+}
@@ -0,0 +1,235 @@
+#include "sim_hal.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <deque>
+#include <vector>
+
+#include "hardware/clocks.h"
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include "hardware/pwm.h"
+#include "pico/bootrom.h"
+#include "pico/time.h"
+
+struct sim_pio {
+    std::deque<uint32_t> rx[4];
+};
+
+static sim_pio_t s_pio[2];
+PIO const g_simPio[2] = {&s_pio[0], &s_pio[1]};
+
+namespace {
+
+struct Alarm {
+    alarm_id_t id;
+    uint64_t due;
+    alarm_callback_t callback;
+    void *userData;
+};
+
+// A PWM counter is (ticks since it was last set) modulo (top + 1); the generation retires the wrap alarm
+// of a slice that was stopped or set since
+struct PwmSlice {
+    pwm_config config;
+    bool enabled;
+    uint64_t setAt;
+    uint32_t setCount;
+    uint32_t generation;
+};
+
+uint64_t s_now = 0;
+alarm_id_t s_nextAlarmId = 1;
+std::vector<Alarm> s_alarms;
+bool s_gpio[32];
+PwmSlice s_pwm[8];
+uint32_t s_pwmRaised = 0;
+uint32_t s_pwmEnabledIrqs = 0;
+irq_handler_t s_irqHandlers[32];
+bool s_irqEnabled[32];
+
+uint64_t pwmTicks(const PwmSlice &slice, const uint64_t us)
+{
+    return (us * clock_get_hz(clk_sys)) / (1000000ULL * slice.config.div);
+}
+
+uint64_t pwmUs(const PwmSlice &slice, const uint64_t ticks)
+{
+    const uint64_t cycles = ticks * slice.config.div;
+    return (cycles * 1000000ULL + clock_get_hz(clk_sys) - 1) / clock_get_hz(clk_sys);
+}
+
+uint32_t pwmCount(const PwmSlice &slice)
+{
+    const uint64_t elapsed = slice.enabled ? pwmTicks(slice, s_now - slice.setAt) : 0;
+    return (slice.setCount + elapsed) % (slice.config.top + 1);
+}
+
+struct PwmWrap {
+    uint slice;
+    uint32_t generation;
+};
+
+int64_t pwmWrapAlarm(alarm_id_t id, void *user_data)
+{
+    PwmWrap *wrap = static_cast<PwmWrap *>(user_data);
+    PwmSlice &slice = s_pwm[wrap->slice];
+    if (!slice.enabled || slice.generation != wrap->generation)
+    {
+        delete wrap;
+        return 0;
+    }
+
+    s_pwmRaised |= 1u << wrap->slice;
+    if ((s_pwmEnabledIrqs & s_pwmRaised) && s_irqEnabled[PWM_IRQ_WRAP] && s_irqHandlers[PWM_IRQ_WRAP])
+    {
+        s_irqHandlers[PWM_IRQ_WRAP]();
+    }
+    return -(int64_t)pwmUs(slice, slice.config.top + 1);
+}
+
+// Counting restarts from the current value whenever a slice is started or set
+void pwmRestart(const uint slice_num, const uint32_t count)
+{
+    PwmSlice &slice = s_pwm[slice_num];
+    slice.setAt = s_now;
+    slice.setCount = count;
+    slice.generation++;
+    if (slice.enabled)
+    {
+        add_alarm_in_us(pwmUs(slice, slice.config.top + 1 - count), pwmWrapAlarm,
+                        new PwmWrap{slice_num, slice.generation}, true);
+    }
+}
+
+}  // namespace
+
+uint64_t sim::now() { return s_now; }
+
+void sim::advance(const uint64_t us)
+{
+    const uint64_t target = s_now + us;
+
+    while (true)
+    {
+        auto next = std::min_element(s_alarms.begin(), s_alarms.end(),
+                                     [](const Alarm &a, const Alarm &b) { return a.due < b.due; });
+        if (next == s_alarms.end() || next->due > target)
+        {
+            break;
+        }
+
+        Alarm alarm = *next;
+        s_alarms.erase(next);
+        s_now = std::max(s_now, alarm.due);
+
+        // Same contract as the SDK: >0 reschedules relative to now, <0 relative to the last due time
+        const int64_t again = alarm.callback(alarm.id, alarm.userData);
+        if (again != 0)
+        {
+            alarm.due = (again > 0) ? s_now + again : alarm.due - again;
+            s_alarms.push_back(alarm);
+        }
+    }
+
+    s_now = target;
+}
+
+void sim::reset()
+{
+    s_now = 0;
+    s_alarms.clear();
+    std::fill(std::begin(s_gpio), std::end(s_gpio), false);
+    for (PwmSlice &slice : s_pwm)
+    {
+        slice.enabled = false;
+        slice.generation++;
+    }
+    s_pwmRaised = 0;
+    for (sim_pio_t &pio : s_pio)
+    {
+        for (auto &fifo : pio.rx)
+        {
+            fifo.clear();
+        }
+    }
+}
+
+void sim::pushRx(PIO pio, const uint sm, const uint32_t word) { pio->rx[sm].push_back(word); }
+
+bool sim::gpioLevel(const uint gpio) { return s_gpio[gpio]; }
+
+uint64_t time_us_64(void) { return s_now; }
+uint32_t time_us_32(void) { return (uint32_t)s_now; }
+
+alarm_id_t add_alarm_in_us(uint64_t us, alarm_callback_t callback, void *user_data, bool fire_if_past)
+{
+    (void)fire_if_past;
+    s_alarms.push_back({s_nextAlarmId, s_now + us, callback, user_data});
+    return s_nextAlarmId++;
+}
+
+alarm_id_t add_alarm_in_ms(uint32_t ms, alarm_callback_t callback, void *user_data, bool fire_if_past)
+{
+    return add_alarm_in_us((uint64_t)ms * 1000, callback, user_data, fire_if_past);
+}
+
+void gpio_put(uint gpio, bool value) { s_gpio[gpio] = value; }
+bool gpio_get(uint gpio) { return s_gpio[gpio]; }
+
+void rom_reset_usb_boot_extra(int usb_activity_gpio_pin, uint32_t disable_interface_mask,
+                              bool usb_activity_gpio_pin_active_low)
+{
+    fprintf(stderr, "sim: firmware requested a reboot into the bootloader\n");
+}
+
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled) {}
+void pio_sm_put_blocking(PIO pio, uint sm, uint32_t data) {}
+
+uint32_t pio_sm_get_blocking(PIO pio, uint sm)
+{
+    if (pio->rx[sm].empty())
+    {
+        return 0;
+    }
+
+    const uint32_t word = pio->rx[sm].front();
+    pio->rx[sm].pop_front();
+    return word;
+}
+
+uint pio_sm_get_rx_fifo_level(PIO pio, uint sm) { return pio->rx[sm].size(); }
+void pio_sm_clear_fifos(PIO pio, uint sm) { pio->rx[sm].clear(); }
+void pio_sm_drain_tx_fifo(PIO pio, uint sm) {}
+void pio_interrupt_clear(PIO pio, uint irq) {}
+bool pio_sm_is_rx_fifo_empty(PIO pio, uint sm) { return pio->rx[sm].empty(); }
+void pio_sm_exec(PIO pio, uint sm, uint instr) {}
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler) { s_irqHandlers[num] = handler; }
+void irq_set_enabled(uint num, bool enabled) { s_irqEnabled[num] = enabled; }
+
+void pwm_init(uint slice_num, pwm_config *c, bool start)
+{
+    s_pwm[slice_num].config = *c;
+    s_pwm[slice_num].enabled = start;
+    pwmRestart(slice_num, 0);
+}
+
+void pwm_set_enabled(uint slice_num, bool enabled)
+{
+    const uint32_t count = pwmCount(s_pwm[slice_num]);
+    s_pwm[slice_num].enabled = enabled;
+    pwmRestart(slice_num, count);
+}
+
+uint16_t pwm_get_counter(uint slice_num) { return pwmCount(s_pwm[slice_num]); }
+void pwm_set_counter(uint slice_num, uint16_t count) { pwmRestart(slice_num, count); }
+
+void pwm_set_irq_enabled(uint slice_num, bool enabled)
+{
+    s_pwmEnabledIrqs = enabled ? (s_pwmEnabledIrqs | (1u << slice_num)) : (s_pwmEnabledIrqs & ~(1u << slice_num));
+}
+
+void pwm_clear_irq(uint slice_num) { s_pwmRaised &= ~(1u << slice_num); }
+uint32_t pwm_get_irq_status_mask(void) { return s_pwmRaised & s_pwmEnabledIrqs; }
@@ -0,0 +1,20 @@
+#pragma once
+
+// Virtual hardware behind the shim SDK headers in tools/host/sim/include. Time only moves when the
+// simulation advances it, alarms fire from advance() in due order, and the mechacon RX FIFO is
+// filled by the console model instead of the PIO program.
+
+#include <stdint.h>
+
+#include "hardware/pio.h"
+
+namespace sim {
+
+uint64_t now();
+void advance(const uint64_t us);
+void reset();
+
+void pushRx(PIO pio, const uint sm, const uint32_t word);
+bool gpioLevel(const uint gpio);
+
+}  // namespace sim
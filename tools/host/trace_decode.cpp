@@ -0,0 +1,140 @@
+// Decodes a picostation.trc file written by the firmware trace recorder (TRACE_RECORDER=ON).
+//
+// usage: trace_decode <picostation.trc> [--summary]
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "trace.h"
+#include "trace_file.h"
+
+using namespace picostation;
+
+static constexpr int c_leadIn = 4500;
+
+static const char *eventName(const uint8_t event)
+{
+    switch (event)
+    {
+        case Trace::EVENT_SECTOR_REQUEST: return "SECTOR";
+        case Trace::EVENT_SECTOR_DMA: return "DMA";
+        case Trace::EVENT_MECH_COMMAND: return "MECH";
+        case Trace::EVENT_SEEK: return "SEEK";
+        case Trace::EVENT_SLED_START: return "SLED_START";
+        case Trace::EVENT_SLED_STOP: return "SLED_STOP";
+        case Trace::EVENT_DROPPED: return "DROPPED";
+        default: return "?";
+    }
+}
+
+static void printRecord(const Trace::Record &rec, const uint32_t start)
+{
+    printf("%10u %-10s ", rec.timestamp - start, eventName(rec.event));
+
+    switch (rec.event)
+    {
+        case Trace::EVENT_SECTOR_REQUEST:
+            printf("lba %6d %s %uus\n", (int)rec.arg0 - c_leadIn,
+                   (rec.flags & Trace::FLAG_CACHE_HIT) ? "hit " : "miss", rec.arg1);
+            break;
+
+        case Trace::EVENT_SECTOR_DMA:
+            printf("lba %6d +%uus\n", (int)rec.arg0 - c_leadIn, rec.arg1);
+            break;
+
+        case Trace::EVENT_MECH_COMMAND:
+            printf("%06X (cmd $%X)\n", rec.arg0 & 0xFFFFFF, (rec.arg0 >> 20) & 0xF);
+            break;
+
+        case Trace::EVENT_SEEK:
+            printf("%d -> %d (%u tracks %c)\n", (int)rec.arg0 - c_leadIn, (int)rec.arg1 - c_leadIn, rec.aux,
+                   (rec.flags & Trace::FLAG_REVERSE) ? '-' : '+');
+            break;
+
+        case Trace::EVENT_SLED_START:
+            printf("at %d %c\n", (int)rec.arg0 - c_leadIn, (rec.flags & Trace::FLAG_REVERSE) ? '-' : '+');
+            break;
+
+        case Trace::EVENT_SLED_STOP:
+            printf("at %d after %u tracks\n", (int)rec.arg0 - c_leadIn, rec.arg1);
+            break;
+
+        case Trace::EVENT_DROPPED:
+            printf("%u records lost on core%u\n", rec.arg0, rec.aux);
+            break;
+
+        default:
+            printf("%02X %02X %04X %08X %08X\n", rec.event, rec.flags, rec.aux, rec.arg0, rec.arg1);
+            break;
+    }
+}
+
+static void printSummary(const std::vector<Trace::Record> &records)
+{
+    uint32_t hits = 0, misses = 0, seeks = 0, commands = 0, dropped = 0;
+    uint32_t worstRead = 0;
+    uint64_t totalRead = 0;
+
+    for (const Trace::Record &rec : records)
+    {
+        switch (rec.event)
+        {
+            case Trace::EVENT_SECTOR_REQUEST:
+                if (rec.flags & Trace::FLAG_CACHE_HIT)
+                {
+                    hits++;
+                }
+                else
+                {
+                    misses++;
+                    totalRead += rec.arg1;
+                    worstRead = std::max(worstRead, rec.arg1);
+                }
+                break;
+
+            case Trace::EVENT_SEEK: seeks++; break;
+            case Trace::EVENT_MECH_COMMAND: commands++; break;
+            case Trace::EVENT_DROPPED: dropped += rec.arg0; break;
+        }
+    }
+
+    const uint32_t requests = hits + misses;
+    printf("records:        %zu (%u dropped)\n", records.size(), dropped);
+    printf("sector reads:   %u (%u hits, %.1f%%)\n", requests, hits, requests ? 100.0 * hits / requests : 0.0);
+    printf("read time:      avg %lluus, worst %uus\n", misses ? (unsigned long long)(totalRead / misses) : 0ull,
+           worstRead);
+    printf("seeks:          %u\n", seeks);
+    printf("mech commands:  %u\n", commands);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s <picostation.trc> [--summary]\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<Trace::Record> records;
+    if (!readTrace(argv[1], records))
+    {
+        return 1;
+    }
+
+    if (argc > 2 && strcmp(argv[2], "--summary") == 0)
+    {
+        printSummary(records);
+        return 0;
+    }
+
+    const uint32_t start = records.empty() ? 0 : records[0].timestamp;
+    for (const Trace::Record &rec : records)
+    {
+        printRecord(rec, start);
+    }
+    return 0;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+// Loads a firmware trace file (see include/trace.h) into time order.
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "trace.h"
+
+inline bool readTrace(const char *path, std::vector<picostation::Trace::Record> &records)
+{
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+    {
+        perror(path);
+        return false;
+    }
+
+    picostation::Trace::FileHeader header;
+    if (fread(&header, sizeof(header), 1, fp) != 1 || header.magic != picostation::Trace::c_fileMagic)
+    {
+        fprintf(stderr, "%s: not a picostation trace\n", path);
+        fclose(fp);
+        return false;
+    }
+
+    if (header.version != picostation::Trace::c_fileVersion || header.recordSize != sizeof(picostation::Trace::Record))
+    {
+        fprintf(stderr, "%s: unsupported trace version %u (record size %u)\n", path, header.version,
+                header.recordSize);
+        fclose(fp);
+        return false;
+    }
+
+    picostation::Trace::Record rec;
+    while (fread(&rec, sizeof(rec), 1, fp) == 1)
+    {
+        records.push_back(rec);
+    }
+    fclose(fp);
+
+    // Each core has its own ring, so blocks from core0 and core1 interleave in the file.
+    // Timestamps are a wrapping 32 bit microsecond counter; sort on the unwrapped value.
+    uint64_t epoch = 0;
+    uint32_t last = records.empty() ? 0 : records[0].timestamp;
+    std::vector<std::pair<uint64_t, size_t>> order;
+    order.reserve(records.size());
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        const uint32_t ts = records[i].timestamp;
+        if (ts < last && (last - ts) > 0x80000000u)
+        {
+            epoch += 1ull << 32;
+        }
+        last = ts;
+        order.emplace_back(epoch | ts, i);
+    }
+    std::stable_sort(order.begin(), order.end());
+
+    std::vector<picostation::Trace::Record> sorted;
+    sorted.reserve(records.size());
+    for (const auto &entry : order)
+    {
+        sorted.push_back(records[entry.second]);
+    }
+    records.swap(sorted);
+    return true;
+}